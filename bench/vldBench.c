@@ -0,0 +1,623 @@
+/**
+ * @copyright Copyright 2022, Jefferson Science Associates, LLC.
+ *            Subject to the terms in the LICENSE file found in the
+ *            top-level directory.
+ *
+ * @author    Bryan Moffit
+ *            moffit@jlab.org                   Jefferson Lab, MS-12B3
+ *            Phone: (757) 269-5660             12000 Jefferson Ave.
+ *            Fax:   (757) 269-5800             Newport News, VA 23606
+ *
+ * @file      vldBench.c
+ * @brief     Microbenchmarks of the VLD library, against the simulated crate
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#ifndef VLD_SIM_ONLY
+#include "jvme.h"
+#endif
+#include "vldLib.h"
+
+/* JLab VXS payload slots, in the order boards are added to the simulated crate */
+static const int32_t benchSlotOrder[16] =
+  { 3, 4, 5, 6, 7, 8, 9, 10, 13, 14, 15, 16, 17, 18, 19, 20 };
+
+static int32_t benchSlot[16];
+static int32_t benchNSlot = 0;
+static uint32_t benchIter = 1000;
+static FILE *benchJSON = NULL;
+static int32_t benchStats = 0;   /* library built with VLD_STATS */
+
+static uint8_t benchPulse[2048];
+static uint32_t benchPulse32[512];
+
+typedef int32_t (*benchFunction)(int32_t id, uint32_t iter);
+
+typedef struct
+{
+  const char *name;
+  benchFunction func;
+  uint32_t iterDivisor;   /* Run benchIter / iterDivisor times */
+} benchCase;
+
+static uint64_t
+benchNow()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t
+benchBusCycles()
+{
+  vldSimCounters c = { 0 };
+
+  vldSimGetCounters(&c);
+  return c.reads + c.writes + c.probes + c.blockReads + c.chainedReads;
+}
+
+/* Lock wait and hold times, summed over functions and slots */
+static void
+benchLockTimes(uint64_t *wait, uint64_t *hold)
+{
+  vldStats st;
+
+  *wait = *hold = 0;
+  if(benchStats && (vldGetStats(-1, -1, &st) == OK))
+    {
+      *wait = st.lockWait;
+      *hold = st.lockHold;
+    }
+}
+
+/* Silence stdout (status printouts) while fn runs */
+static int32_t
+benchQuiet(int32_t (*fn)(int32_t, uint32_t), int32_t id, uint32_t iter)
+{
+  int32_t saved, devnull, rval;
+
+  fflush(stdout);
+  saved = dup(STDOUT_FILENO);
+  devnull = open("/dev/null", O_WRONLY);
+  dup2(devnull, STDOUT_FILENO);
+  close(devnull);
+
+  rval = fn(id, iter);
+
+  /* The library's messages are queued, write them while stdout is quiet */
+  vldLogFlush();
+  fflush(stdout);
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+
+  return rval;
+}
+
+/* Wrappers, one call of each public routine */
+static int32_t bCheckAddresses(int32_t id, uint32_t i) { return vldCheckAddresses(); }
+static int32_t bSlot(int32_t id, uint32_t i) { return vldSlot(i % benchNSlot); }
+static int32_t bSlotMask(int32_t id, uint32_t i) { return vldSlotMask() ? OK : ERROR; }
+static int32_t bGetGeoAddress(int32_t id, uint32_t i) { return vldGetGeoAddress(id); }
+static int32_t bCacheInvalidate(int32_t id, uint32_t i) { return vldCacheInvalidate(id); }
+static int32_t bCacheRefresh(int32_t id, uint32_t i) { return vldCacheRefresh(id); }
+static int32_t
+bConfigTransaction(int32_t id, uint32_t i)
+{
+  vldConfigBegin(id);
+  vldSetTriggerDelayWidth(id, 35, 0, 31);
+  vldSetRandomPulser(id, 5, 1);
+  vldSetBleachTime(id, 0xabcc, 1);
+  vldSetTriggerSourceMask(id, 2);
+  return vldConfigCommit(id);
+}
+static int32_t bConfigAbort(int32_t id, uint32_t i) { vldConfigBegin(id); return vldConfigAbort(id); }
+static int32_t bGStatusQuiet(int32_t id, uint32_t i) { vldGStatus(0); return OK; }
+static int32_t bGStatus(int32_t id, uint32_t i) { return benchQuiet(bGStatusQuiet, id, i); }
+static int32_t bCheckAddressesQuiet(int32_t id, uint32_t i) { return benchQuiet(bCheckAddresses, id, i); }
+static int32_t bSetTriggerDelayWidth(int32_t id, uint32_t i) { return vldSetTriggerDelayWidth(id, i & 0x7F, 0, 31); }
+static int32_t
+bGetTriggerDelayWidth(int32_t id, uint32_t i)
+{
+  int32_t d, s, w;
+  return vldGetTriggerDelayWidth(id, &d, &s, &w);
+}
+static int32_t bSetTriggerSourceMask(int32_t id, uint32_t i) { return vldSetTriggerSourceMask(id, 2); }
+static int32_t bGetTriggerSourceMask(int32_t id, uint32_t i) { uint32_t v; return vldGetTriggerSourceMask(id, &v); }
+static int32_t bSetClockSource(int32_t id, uint32_t i) { return vldSetClockSource(id, i & 1); }
+static int32_t bGSetClockSource(int32_t id, uint32_t i) { return vldGSetClockSource(i & 1); }
+static int32_t bGetClockSource(int32_t id, uint32_t i) { uint32_t v; return vldGetClockSource(id, &v); }
+static int32_t bLEDCalibration(int32_t id, uint32_t i) { return vldLEDCalibration(id, i % 5, 3, 0, 0, 0); }
+static int32_t bSetBleachTime(int32_t id, uint32_t i) { return vldSetBleachTime(id, 0xabcc, 1); }
+static int32_t bGetBleachTime(int32_t id, uint32_t i) { uint32_t t, e; return vldGetBleachTime(id, &t, &e); }
+static int32_t bLoadPulse(int32_t id, uint32_t i) { return vldLoadPulse(id, benchPulse, 2048); }
+static int32_t bLoadPulse32(int32_t id, uint32_t i) { return vldLoadPulse32(id, benchPulse32, 512); }
+static int32_t bSetCalibrationPulseWidth(int32_t id, uint32_t i) { return vldSetCalibrationPulseWidth(id, 100); }
+static int32_t bGetCalibrationPulseWidth(int32_t id, uint32_t i) { uint32_t w; return vldGetCalibrationPulseWidth(id, &w); }
+static int32_t bSetAnalogSwitchControl(int32_t id, uint32_t i) { return vldSetAnalogSwitchControl(id, 10, 20); }
+static int32_t bGetAnalogSwitchControl(int32_t id, uint32_t i) { uint32_t d, w; return vldGetAnalogSwitchControl(id, &d, &w); }
+static int32_t bSetRandomPulser(int32_t id, uint32_t i) { return vldSetRandomPulser(id, 5, 1); }
+static int32_t bGetRandomPulser(int32_t id, uint32_t i) { uint32_t p, e; return vldGetRandomPulser(id, &p, &e); }
+static int32_t bSetPeriodicPulser(int32_t id, uint32_t i) { return vldSetPeriodicPulser(id, 100, 10); }
+static int32_t bGetPeriodicPulser(int32_t id, uint32_t i) { uint32_t p, n; return vldGetPeriodicPulser(id, &p, &n); }
+static int32_t bGetTriggerCount(int32_t id, uint32_t i) { uint32_t c; return vldGetTriggerCount(id, &c); }
+static int32_t bResetMask(int32_t id, uint32_t i) { return vldResetMask(id, VLD_RESET_I2C); }
+static int32_t bResetI2C(int32_t id, uint32_t i) { return vldResetI2C(id); }
+static int32_t bResetJTAG(int32_t id, uint32_t i) { return vldResetJTAG(id); }
+static int32_t bSoftReset(int32_t id, uint32_t i) { return vldSoftReset(id); }
+static int32_t bResetClockDCM(int32_t id, uint32_t i) { return vldResetClockDCM(id); }
+static int32_t bResetMGT(int32_t id, uint32_t i) { return vldResetMGT(id); }
+static int32_t bHardClockReset(int32_t id, uint32_t i) { return vldHardClockReset(id); }
+static int32_t bGExecuteRoutine(int32_t id, void *arg) { uint32_t c; return vldGetTriggerCount(id, &c); }
+static int32_t bGExecute(int32_t id, uint32_t i) { return vldGExecute(bGExecuteRoutine, NULL, NULL); }
+static int32_t bSamplerGetCount(int32_t id, uint32_t i) { uint64_t c; return vldSamplerGetCount(id, &c, NULL); }
+static int32_t
+bSamplerGetHistory(int32_t id, uint32_t i)
+{
+  vldTriggerSample s[16];
+  return (vldSamplerGetHistory(id, s, 16) >= 0) ? OK : ERROR;
+}
+static int32_t bRescanQuiet(int32_t id, uint32_t i) { return vldRescan(0); }
+static int32_t bRescan(int32_t id, uint32_t i) { return benchQuiet(bRescanQuiet, id, i); }
+static int32_t bGetFirmwareVersion(int32_t id, uint32_t i) { return vldGetFirmwareVersion(id); }
+static int32_t bGetA24Address(int32_t id, uint32_t i) { return vldGetA24Address(id); }
+static int32_t
+bGetLEDCalibration(int32_t id, uint32_t i)
+{
+  uint32_t lo, hi, ctrl, en;
+  return vldGetLEDCalibration(id, i % 5, &lo, &hi, &ctrl, &en);
+}
+static int32_t bReadImage(int32_t id, uint32_t i) { vldRegs image; return vldReadImage(id, &image); }
+static int32_t
+bGReadWindow(int32_t id, uint32_t i)
+{
+  uint32_t data[(MAX_VME_SLOTS+1) * 4];
+  return (vldGReadWindow(vldSlotMask(), 0xD0, 4, data) >= 0) ? OK : ERROR;
+}
+static int32_t bGGetTriggerCount(int32_t id, uint32_t i) { uint32_t c[MAX_VME_SLOTS+1]; return vldGGetTriggerCount(c); }
+static int32_t
+bGExecuteMask(int32_t id, uint32_t i)
+{
+  return vldGExecuteMask(vldSlotMask(), bGExecuteRoutine, NULL, NULL);
+}
+static vldStatus benchStatus[MAX_VME_SLOTS+1];
+static int32_t
+bGetStatusSnapshot(int32_t id, uint32_t i)
+{
+  return (vldGetStatusSnapshot(benchStatus, MAX_VME_SLOTS+1) >= 0) ? OK : ERROR;
+}
+static uint8_t benchDelta[(MAX_VME_SLOTS+1) * (10 + sizeof(vldStatus)) + 16];
+static uint64_t benchDeltaToken;
+static int32_t
+bGetStatusDelta(int32_t id, uint32_t i)
+{
+  return (vldGetStatusDelta(benchDeltaToken, &benchDeltaToken, benchDelta, sizeof(benchDelta)) >= 0) ?
+    OK : ERROR;
+}
+static int32_t
+bGetPublishedStatus(int32_t id, uint32_t i)
+{
+  vldStatus status;
+  return vldGetPublishedStatus(id, &status, NULL, NULL);
+}
+static int32_t
+bSetClockSourceAsync(int32_t id, uint32_t i)
+{
+  vldClockSwitch cs;
+  if(vldSetClockSourceAsync(&cs, vldSlotMask(), i & 1, NULL, NULL) != OK)
+    return ERROR;
+  return vldClockSwitchWait(&cs);
+}
+static int32_t
+bBringUpQuiet(int32_t id, uint32_t i)
+{
+  vldBringUpConfig config;
+
+  memset(&config, 0, sizeof(config));
+  config.stages = VLD_BRINGUP_CLOCK | VLD_BRINGUP_PULSE | VLD_BRINGUP_TRIGDELAY |
+    VLD_BRINGUP_RANDOM | VLD_BRINGUP_TRIGSRC;
+  config.pulse = benchPulse32;
+  config.npulse = 512;
+  config.trigDelay = 35;
+  config.trigWidth = 31;
+  config.randomPrescale = 5;
+  config.randomEnable = 1;
+  config.trigSrc = 2;
+  return vldBringUp(&config, NULL);
+}
+static int32_t bBringUp(int32_t id, uint32_t i) { return benchQuiet(bBringUpQuiet, id, i); }
+
+/* Not benchmarked:
+   - The vldCrate variants.  The routines here are wrappers of them, with the default crate
+   - Setup before vldInit: vldSetArena, vldArenaRequired, vldAttachShared, vldUnlinkShared,
+     vldSetDiscoveryCache, vldGSetWorkers
+   - Logging, errors, and statistics: vldLog*, vldGetLastError, vldClearLastError,
+     vldErrorString, vldPrintStats, vldStatsName, vldGetArenaUsage
+   - Encoding and decoding of a status, with no bus access or locks: vldStatusToBinary,
+     vldStatusToJSON, vldStatusApplyDelta
+   - vldClockSwitchDoneMask, a load of the switch structure */
+
+/* Single thread cost of each routine.  Per-slot routines cycle through the boards */
+static const benchCase benchCases[] =
+  {
+    { "vldCheckAddresses",           bCheckAddressesQuiet,      10 },
+    { "vldSlot",                     bSlot,                     1 },
+    { "vldSlotMask",                 bSlotMask,                 1 },
+    { "vldGetGeoAddress",            bGetGeoAddress,            1 },
+    { "vldCacheInvalidate",          bCacheInvalidate,          1 },
+    { "vldCacheRefresh",             bCacheRefresh,             1 },
+    { "vldConfigBegin/Commit",       bConfigTransaction,        1 },
+    { "vldConfigBegin/Abort",        bConfigAbort,              1 },
+    { "vldGStatus",                  bGStatus,                  10 },
+    { "vldSetTriggerDelayWidth",     bSetTriggerDelayWidth,     1 },
+    { "vldGetTriggerDelayWidth",     bGetTriggerDelayWidth,     1 },
+    { "vldSetTriggerSourceMask",     bSetTriggerSourceMask,     1 },
+    { "vldGetTriggerSourceMask",     bGetTriggerSourceMask,     1 },
+    { "vldGetClockSource",           bGetClockSource,           1 },
+    { "vldLEDCalibration",           bLEDCalibration,           1 },
+    { "vldSetBleachTime",            bSetBleachTime,            1 },
+    { "vldGetBleachTime",            bGetBleachTime,            1 },
+    { "vldLoadPulse",                bLoadPulse,                100 },
+    { "vldLoadPulse32",              bLoadPulse32,              100 },
+    { "vldSetCalibrationPulseWidth", bSetCalibrationPulseWidth, 1 },
+    { "vldGetCalibrationPulseWidth", bGetCalibrationPulseWidth, 1 },
+    { "vldSetAnalogSwitchControl",   bSetAnalogSwitchControl,   1 },
+    { "vldGetAnalogSwitchControl",   bGetAnalogSwitchControl,   1 },
+    { "vldSetRandomPulser",          bSetRandomPulser,          1 },
+    { "vldGetRandomPulser",          bGetRandomPulser,          1 },
+    { "vldSetPeriodicPulser",        bSetPeriodicPulser,        1 },
+    { "vldGetPeriodicPulser",        bGetPeriodicPulser,        1 },
+    { "vldGetTriggerCount",          bGetTriggerCount,          1 },
+    { "vldResetMask",                bResetMask,                1 },
+    { "vldResetI2C",                 bResetI2C,                 1 },
+    { "vldResetJTAG",                bResetJTAG,                1 },
+    { "vldSoftReset",                bSoftReset,                1 },
+    { "vldResetClockDCM",            bResetClockDCM,            1 },
+    { "vldResetMGT",                 bResetMGT,                 1 },
+    { "vldHardClockReset",           bHardClockReset,           1 },
+    { "vldGExecute",                 bGExecute,                 10 },
+    { "vldSamplerGetCount",          bSamplerGetCount,          1 },
+    { "vldSamplerGetHistory",        bSamplerGetHistory,        1 },
+    { "vldRescan",                   bRescan,                   100 },
+    { "vldGetFirmwareVersion",       bGetFirmwareVersion,       1 },
+    { "vldGetA24Address",            bGetA24Address,            1 },
+    { "vldGetLEDCalibration",        bGetLEDCalibration,        1 },
+    { "vldReadImage",                bReadImage,                1 },
+    { "vldGReadWindow",              bGReadWindow,              10 },
+    { "vldGGetTriggerCount",         bGGetTriggerCount,         10 },
+    { "vldGExecuteMask",             bGExecuteMask,             10 },
+    { "vldGetStatusSnapshot",        bGetStatusSnapshot,        10 },
+    { "vldGetStatusDelta",           bGetStatusDelta,           10 },
+    { "vldGetPublishedStatus",       bGetPublishedStatus,       1 },
+  };
+#define NBENCHCASES (sizeof(benchCases)/sizeof(benchCases[0]))
+
+/* Clock source switching waits out the settle interval, so is only run with -c */
+static const benchCase benchClockCases[] =
+  {
+    { "vldSetClockSource",           bSetClockSource,           0 },
+    { "vldGSetClockSource",          bGSetClockSource,          0 },
+    { "vldSetClockSourceAsync/Wait", bSetClockSourceAsync,      0 },
+    { "vldBringUp",                  bBringUp,                  0 },
+  };
+
+/* Multi-threaded mixes */
+static const benchFunction benchMixGetters[] =
+  {
+    bGetTriggerDelayWidth, bGetTriggerSourceMask, bGetClockSource, bGetBleachTime,
+    bGetCalibrationPulseWidth, bGetAnalogSwitchControl, bGetRandomPulser, bGetPeriodicPulser
+  };
+static const benchFunction benchMixConfig[] =
+  {
+    bGetTriggerSourceMask, bSetTriggerDelayWidth, bGetBleachTime, bSetRandomPulser,
+    bGetTriggerCount, bLEDCalibration, bGetRandomPulser, bGetTriggerCount
+  };
+static const benchFunction benchMixReadout[] =
+  {
+    bGetTriggerCount
+  };
+static const benchFunction benchMixPulseLoad[] =
+  {
+    bLoadPulse32, bGetTriggerCount, bGetTriggerCount, bGetTriggerCount
+  };
+
+typedef struct
+{
+  const char *name;
+  const benchFunction *func;
+  uint32_t nfunc;
+} benchMix;
+
+static const benchMix benchMixes[] =
+  {
+    { "mix:getters",   benchMixGetters,   sizeof(benchMixGetters)/sizeof(benchFunction) },
+    { "mix:config",    benchMixConfig,    sizeof(benchMixConfig)/sizeof(benchFunction) },
+    { "mix:readout",   benchMixReadout,   sizeof(benchMixReadout)/sizeof(benchFunction) },
+    { "mix:pulseload", benchMixPulseLoad, sizeof(benchMixPulseLoad)/sizeof(benchFunction) },
+  };
+#define NBENCHMIXES (sizeof(benchMixes)/sizeof(benchMixes[0]))
+
+typedef struct
+{
+  const benchMix *mix;
+  int32_t thread;
+  uint32_t niter;
+  pthread_barrier_t *start;
+} benchThreadArg;
+
+static void
+benchReport(const char *name, int32_t nboards, int32_t nthreads, uint64_t nops,
+	    uint64_t ns, uint64_t cycles, uint64_t wait, uint64_t hold)
+{
+  double nsPerOp = nops ? (double)ns / nops : 0;
+  double cyclesPerOp = nops ? (double)cycles / nops : 0;
+  double waitPerOp = nops ? (double)wait / nops : 0;
+  double holdPerOp = nops ? (double)hold / nops : 0;
+
+  printf("%-28s %6d %7d %8llu %12.1f %10.2f",
+	 name, nboards, nthreads, (unsigned long long)nops, nsPerOp, cyclesPerOp);
+  if(benchStats)
+    printf(" %10.1f %10.1f", waitPerOp, holdPerOp);
+  printf("\n");
+
+  if(benchJSON)
+    {
+      fprintf(benchJSON,
+	      "{\"name\":\"%s\",\"boards\":%d,\"threads\":%d,\"ops\":%llu,"
+	      "\"ns_per_op\":%.1f,\"bus_cycles_per_op\":%.3f",
+	      name, nboards, nthreads, (unsigned long long)nops, nsPerOp, cyclesPerOp);
+      if(benchStats)
+	fprintf(benchJSON, ",\"lock_wait_ns_per_op\":%.1f,\"lock_hold_ns_per_op\":%.1f",
+		waitPerOp, holdPerOp);
+      fprintf(benchJSON, "}\n");
+    }
+}
+
+static void
+benchRunCase(const benchCase *bc, uint32_t niter)
+{
+  uint64_t t0, cycles0, wait0, hold0, wait1, hold1;
+  uint32_t iter;
+
+  benchLockTimes(&wait0, &hold0);
+  cycles0 = benchBusCycles();
+  t0 = benchNow();
+  for(iter = 0; iter < niter; iter++)
+    bc->func(benchSlot[iter % benchNSlot], iter);
+  t0 = benchNow() - t0;
+  cycles0 = benchBusCycles() - cycles0;
+  benchLockTimes(&wait1, &hold1);
+
+  benchReport(bc->name, benchNSlot, 1, niter, t0, cycles0, wait1 - wait0, hold1 - hold0);
+}
+
+static void *
+benchThread(void *varg)
+{
+  benchThreadArg *arg = (benchThreadArg *)varg;
+  const benchMix *mix = arg->mix;
+  uint32_t iter, index;
+
+  pthread_barrier_wait(arg->start);
+
+  for(iter = 0; iter < arg->niter; iter++)
+    {
+      /* Each thread starts on a different board */
+      index = iter + arg->thread;
+      mix->func[index % mix->nfunc](benchSlot[index % benchNSlot], iter);
+    }
+
+  return NULL;
+}
+
+static void
+benchRunMix(const benchMix *mix, int32_t nthreads)
+{
+  pthread_t thread[64];
+  benchThreadArg arg[64];
+  pthread_barrier_t start;
+  uint64_t t0, cycles0, wait0, hold0, wait1, hold1;
+  int32_t ithread;
+
+  pthread_barrier_init(&start, NULL, nthreads + 1);
+  for(ithread = 0; ithread < nthreads; ithread++)
+    {
+      arg[ithread].mix = mix;
+      arg[ithread].thread = ithread;
+      arg[ithread].niter = benchIter;
+      arg[ithread].start = &start;
+      pthread_create(&thread[ithread], NULL, benchThread, &arg[ithread]);
+    }
+
+  benchLockTimes(&wait0, &hold0);
+  cycles0 = benchBusCycles();
+  t0 = benchNow();
+  pthread_barrier_wait(&start);
+  for(ithread = 0; ithread < nthreads; ithread++)
+    pthread_join(thread[ithread], NULL);
+  t0 = benchNow() - t0;
+  cycles0 = benchBusCycles() - cycles0;
+  benchLockTimes(&wait1, &hold1);
+
+  benchReport(mix->name, benchNSlot, nthreads, (uint64_t)benchIter * nthreads,
+	      t0, cycles0, wait1 - wait0, hold1 - hold0);
+  pthread_barrier_destroy(&start);
+}
+
+/* Run the benchmarks for a crate of nboards.  Runs in its own process, for a fresh library */
+static void
+benchCrate(int32_t nboards, int32_t maxThreads, int32_t clockCases)
+{
+  uint32_t slotMask = 0, niter;
+  uint64_t t0, cycles0;
+  int32_t iboard, ibench, nthreads;
+  benchCase init = { "vldInit", NULL, 0 };
+
+  for(iboard = 0; iboard < nboards; iboard++)
+    slotMask |= (1 << benchSlotOrder[iboard]);
+
+  vldSimConfigure(slotMask, 0x24, 1);
+
+  /* Full scan of the crate, with empty slots timing out */
+  fflush(stdout);
+  cycles0 = benchBusCycles();
+  t0 = benchNow();
+  {
+    int32_t saved = dup(STDOUT_FILENO), devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, STDOUT_FILENO);
+    vldInit(0, 0, 0, 0);
+    vldLogFlush();
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(devnull);
+    close(saved);
+  }
+  benchReport(init.name, nboards, 1, 1, benchNow() - t0, benchBusCycles() - cycles0, 0, 0);
+
+  benchNSlot = 0;
+  for(iboard = 0; iboard < nboards; iboard++)
+    benchSlot[benchNSlot++] = benchSlotOrder[iboard];
+
+  vldSamplerStart(1000);
+  usleep(10000);
+
+  for(ibench = 0; ibench < NBENCHCASES; ibench++)
+    {
+      niter = benchIter / benchCases[ibench].iterDivisor;
+      benchRunCase(&benchCases[ibench], niter ? niter : 1);
+    }
+
+  if(clockCases)
+    {
+      for(ibench = 0; ibench < sizeof(benchClockCases)/sizeof(benchCase); ibench++)
+	benchRunCase(&benchClockCases[ibench], 1);
+    }
+
+  for(ibench = 0; ibench < NBENCHMIXES; ibench++)
+    {
+      for(nthreads = 1; nthreads <= maxThreads; nthreads *= 2)
+	benchRunMix(&benchMixes[ibench], nthreads);
+    }
+
+  vldSamplerStop();
+}
+
+static void
+benchUsage(const char *prog)
+{
+  printf("Usage: %s [options]\n", prog);
+  printf("  -b <n>     Largest number of boards in the crate (1-16, default 16)\n");
+  printf("  -t <n>     Largest number of threads for the mixes (default 8)\n");
+  printf("  -n <n>     Iterations per benchmark (default 1000)\n");
+  printf("  -r <ns>    Bus read latency (default 1000)\n");
+  printf("  -w <ns>    Bus write latency (default 300)\n");
+  printf("  -e <ns>    Bus error (empty slot probe) timeout (default 20000)\n");
+  printf("  -l <ns>    Block read latency per word (default 100)\n");
+  printf("  -o         Allow bus cycles to overlap (default serial)\n");
+  printf("  -c         Include clock source switching (waits out the settle interval)\n");
+  printf("  -j <file>  Also write results as JSON lines to file\n");
+}
+
+int32_t
+main(int32_t argc, char *argv[])
+{
+  vldSimTiming timing = { 1000, 300, 20000, 1, 100 };
+  int32_t maxBoards = 16, maxThreads = 8, clockCases = 0, nboards, opt, i;
+  pid_t pid;
+
+  while((opt = getopt(argc, argv, "b:t:n:r:w:e:l:ocj:h")) != -1)
+    {
+      switch(opt)
+	{
+	case 'b': maxBoards = strtol(optarg, NULL, 10); break;
+	case 't': maxThreads = strtol(optarg, NULL, 10); break;
+	case 'n': benchIter = strtoul(optarg, NULL, 10); break;
+	case 'r': timing.readLatency = strtoul(optarg, NULL, 10); break;
+	case 'w': timing.writeLatency = strtoul(optarg, NULL, 10); break;
+	case 'e': timing.probeTimeout = strtoul(optarg, NULL, 10); break;
+	case 'l': timing.blockLatency = strtoul(optarg, NULL, 10); break;
+	case 'o': timing.serialBus = 0; break;
+	case 'c': clockCases = 1; break;
+	case 'j':
+	  benchJSON = fopen(optarg, "w");
+	  if(benchJSON == NULL)
+	    {
+	      perror("fopen");
+	      return ERROR;
+	    }
+	  break;
+	default:
+	  benchUsage(argv[0]);
+	  return ERROR;
+	}
+    }
+
+  if((maxBoards < 1) || (maxBoards > 16) || (maxThreads < 1) || (maxThreads > 64) ||
+     (benchIter == 0))
+    {
+      benchUsage(argv[0]);
+      return ERROR;
+    }
+
+#ifndef VLD_SIM_ONLY
+  vldSetBackend(&vldSimBackend);
+#endif
+  vldSimSetTiming(&timing);
+
+  /* Lock times are only available when the library collects statistics */
+  benchStats = vldStatsAvailable();
+  if(benchStats)
+    vldResetStats();
+  else
+    printf("Library built without statistics (STATS=1), lock times not shown\n");
+
+  for(i = 0; i < 2048; i++)
+    benchPulse[i] = i & 0x3F;
+  for(i = 0; i < 512; i++)
+    benchPulse32[i] = 0x01010101 * (i & 0x3F);
+
+  printf("VLD library benchmarks: bus read %u ns, write %u ns, bus error %u ns, %s bus\n",
+	 timing.readLatency, timing.writeLatency, timing.probeTimeout,
+	 timing.serialBus ? "serial" : "overlapping");
+  printf("%-28s %6s %7s %8s %12s %10s",
+	 "Function", "Boards", "Threads", "Ops", "ns/op", "Cycles/op");
+  if(benchStats)
+    printf(" %10s %10s", "Wait/op", "Hold/op");
+  printf("\n");
+  printf("--------------------------------------------------------------------------------%s\n",
+	 benchStats ? "----------------------" : "");
+  fflush(stdout);
+  if(benchJSON)
+    fflush(benchJSON);
+
+  for(nboards = 1; nboards <= maxBoards; nboards *= 2)
+    {
+      pid = fork();
+      if(pid == 0)
+	{
+	  benchCrate(nboards, maxThreads, clockCases);
+	  fflush(stdout);
+	  if(benchJSON)
+	    fclose(benchJSON);
+	  _exit(0);
+	}
+      waitpid(pid, NULL, 0);
+
+      /* Include the largest crate, if it's not a power of 2 */
+      if((nboards < maxBoards) && (nboards * 2 > maxBoards))
+	nboards = maxBoards / 2;
+    }
+
+  if(benchJSON)
+    fclose(benchJSON);
+
+  return OK;
+}
@@ -54,7 +54,7 @@ VLDtest5(unsigned int islot)
 {
   unsigned int DataLow, DataHigh, nsamples = 512;
   int iloop, iconnector;
-  uint32_t DataLoad, *dac_samples;
+  uint32_t DataLoad, dac_samples[512];
 
   printf(" Calibration pulse amplitude test \n");
   printf(" Probe the Channel#1 of each connector with an oscilloscpoe \n");
@@ -62,8 +62,6 @@ VLDtest5(unsigned int islot)
   /* Initialize VLD at islot */
   vldInit(islot << 19, 0, 1, 0);
 
-  dac_samples = (uint32_t *)malloc(nsamples * sizeof(uint32_t));
-
   for (iloop = 0; iloop < nsamples; iloop++)
     {
       if ((iloop <4)  || (iloop >143))
@@ -124,7 +122,4 @@ VLDtest5(unsigned int islot)
 
   vldSetTriggerSourceMask(islot, 0);
   printf("\n Trigger disabled \n");
-
-  if(dac_samples)
-    free(dac_samples);
 }
@@ -57,7 +57,7 @@ VLDtest6(unsigned int islot)
 {
   unsigned int TestReg, DataLow, DataHigh, nsamples = 512;
   int iloop, iconnector, iwaitsum, ReadyNext, iBleach;
-  uint32_t DataLoad, *dac_samples;
+  uint32_t DataLoad, dac_samples[512];
 
   printf(" Test the individual channels, \n");
   printf(" Move the LED cable from connector to connector. \n");
@@ -69,8 +69,6 @@ VLDtest6(unsigned int islot)
   vldSetBleachTime(islot, 0xabcc, 1); /* about 1000 seconds */
 
   /* set the a constant calibration pulse */
-  dac_samples = (uint32_t *)malloc(nsamples * sizeof(uint32_t));
-
   for (iloop = 0; iloop < nsamples; iloop++)
     {
       if ((iloop <4)  || (iloop >143))
@@ -169,8 +167,4 @@ VLDtest6(unsigned int islot)
       printf(" Disabled the bleaching \n");
     }
   printf("\n All the channels are tested \n");
-
-  if(dac_samples)
-    free(dac_samples);
-
 }
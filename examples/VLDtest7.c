@@ -56,7 +56,7 @@ VLDtest7(unsigned int islot)
 {
   unsigned long BaseAdd, *laddr, TestReg, DataLow, DataHigh, nsamples = 512;
   int iloop, iconnector, iwaitsum, ReadyNext;
-  uint32_t DataLoad, *dac_samples;
+  uint32_t DataLoad, dac_samples[512];
 
   printf(" Calibration pulse amplitude test \n");
   printf(" Probe the Channel#1 of each connector with an oscilloscpoe \n");
@@ -64,8 +64,6 @@ VLDtest7(unsigned int islot)
   /* Initialize VLD at islot */
   vldInit(islot << 19, 0, 1, 0);
 
-  dac_samples = (uint32_t *)malloc(nsamples * sizeof(uint32_t));
-
   for (iloop = 0; iloop < nsamples; iloop++)
     {
       if ((iloop <4)  || (iloop >143))
@@ -149,8 +147,4 @@ VLDtest7(unsigned int islot)
   /* disable the trigger: */
   vldSetTriggerSourceMask(islot, 0);
   printf("\n Trigger disabled \n");
-
-  if(dac_samples)
-    free(dac_samples);
-
 }
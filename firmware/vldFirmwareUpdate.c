@@ -37,9 +37,8 @@ extern unsigned int sysUnivSetUserAM(int, int);
 extern unsigned int sysUnivSetLSI(unsigned short, unsigned short);
 #endif /*TEMPE*/
 #endif
-extern volatile vldRegs *VLDp[MAX_VME_SLOTS+1];
-extern uint16_t vldFWVers[MAX_VME_SLOTS+1];
 typedef volatile unsigned int * vuintptr_t;
+static const vldBackend *vldBus;
 vuintptr_t eJTAGLoad;
 unsigned int firmwareInfo;
 char *programName;
@@ -96,6 +95,8 @@ main(int argc, char *argv[])
 
 #endif
 
+  vldBus = vldGetBackend();
+
   stat = vldInit(vme_addr, 0, 1, 0);
   if (stat != OK)
     {
@@ -131,7 +132,7 @@ main(int argc, char *argv[])
 
   if (badInit == 0)
     {
-      firmwareInfo = vldFWVers[vldSlot(0)];
+      firmwareInfo = vldGetFirmwareVersion(vldSlot(0));
       if (firmwareInfo > 0)
 	{
 	  printf("\n  Board Firmware = 0x%x\n", firmwareInfo);
@@ -167,39 +168,25 @@ REPEAT2:
   else
     geo = -1;
 
-  if (geo <= 0)
+  if (geo == 0)
     {
-      if (geo == 0)
-	{
-	  printf("  ...Detected non VME-64X crate...\n");
+      printf("  ...Detected non VME-64X crate...\n");
 
-	  /* Need to reset the Address to 0 to communicate with the emergency loading AM */
-	  vme_addr = 0;
-	}
-
-#ifdef VXWORKS
-      stat = sysBusToLocalAdrs(0x39, (char *) vme_addr, (char **) &laddr);
-      if (stat != 0)
-	{
-	  printf("%s: ERROR: Error in sysBusToLocalAdrs res=%d \n",
-		 __FUNCTION__, stat);
-	  goto CLOSE;
-	}
-#else
-      stat =
-	vmeBusToLocalAdrs(0x39, (char *) (unsigned long) vme_addr,
-			  (char **) &laddr);
-      if (stat != 0)
-	{
-	  printf("%s: ERROR: Error in vmeBusToLocalAdrs res=%d \n",
-		 __FUNCTION__, stat);
-	  goto CLOSE;
-	}
-#endif
+      /* Need to reset the Address to 0 to communicate with the emergency loading AM */
+      vme_addr = 0;
     }
-  else
+  else if (geo > 0)
     {
-      laddr = (unsigned long)VLDp[vldSlot(0)];
+      /* The module found by vldInit (a slot number argument is shifted to its A24 address) */
+      vme_addr = vldGetA24Address(vldSlot(0));
+    }
+
+  stat = vldBus->busToLocal(vme_addr, (uintptr_t *) &laddr);
+  if (stat != 0)
+    {
+      printf("%s: ERROR: Error in %s busToLocal res=%d \n",
+	     __FUNCTION__, vldBus->name, stat);
+      goto CLOSE;
     }
   eJTAGLoad = (vuintptr_t) (laddr + 0xFFFC);
 
@@ -330,19 +317,19 @@ Emergency(unsigned int jtagType, unsigned int numBits, unsigned int *jtagData)
     {
       for (iloop = 0; iloop < 5; iloop++)
 	{
-	  vmeWrite32((vuintptr_t)eJTAGLoad, 1);
+	  vldBus->write32((vuintptr_t)eJTAGLoad, 1);
 	}
 
-      vmeWrite32((vuintptr_t)eJTAGLoad, 0);
+      vldBus->write32((vuintptr_t)eJTAGLoad, 0);
     }
   else if (jtagType == 1)	// JTAG instruction shift
     {
       // Shift_IR header:
-      vmeWrite32((vuintptr_t)eJTAGLoad, 0);
-      vmeWrite32((vuintptr_t)eJTAGLoad, 1);
-      vmeWrite32((vuintptr_t)eJTAGLoad, 1);
-      vmeWrite32((vuintptr_t)eJTAGLoad, 0);
-      vmeWrite32((vuintptr_t)eJTAGLoad, 0);
+      vldBus->write32((vuintptr_t)eJTAGLoad, 0);
+      vldBus->write32((vuintptr_t)eJTAGLoad, 1);
+      vldBus->write32((vuintptr_t)eJTAGLoad, 1);
+      vldBus->write32((vuintptr_t)eJTAGLoad, 0);
+      vldBus->write32((vuintptr_t)eJTAGLoad, 0);
 
       for (iloop = 0; iloop < numBits; iloop++)
 	{
@@ -351,20 +338,20 @@ Emergency(unsigned int jtagType, unsigned int numBits, unsigned int *jtagData)
 	  shData = ((jtagData[iword] >> ibit) << 1) & 0x2;
 	  if (iloop == numBits - 1)
 	    shData = shData + 1;	//set the TMS high for last bit to exit Shift_IR
-	  vmeWrite32((vuintptr_t)eJTAGLoad, shData);
+	  vldBus->write32((vuintptr_t)eJTAGLoad, shData);
 	}
 
       // shift _IR tail
-      vmeWrite32((vuintptr_t)eJTAGLoad, 1);
-      vmeWrite32((vuintptr_t)eJTAGLoad, 0);
+      vldBus->write32((vuintptr_t)eJTAGLoad, 1);
+      vldBus->write32((vuintptr_t)eJTAGLoad, 0);
     }
   else if (jtagType == 2)	// JTAG data shift
     {
       //shift_DR header
-      vmeWrite32((vuintptr_t)eJTAGLoad, 0);
-      vmeWrite32((vuintptr_t)eJTAGLoad, 1);
-      vmeWrite32((vuintptr_t)eJTAGLoad, 0);
-      vmeWrite32((vuintptr_t)eJTAGLoad, 0);
+      vldBus->write32((vuintptr_t)eJTAGLoad, 0);
+      vldBus->write32((vuintptr_t)eJTAGLoad, 1);
+      vldBus->write32((vuintptr_t)eJTAGLoad, 0);
+      vldBus->write32((vuintptr_t)eJTAGLoad, 0);
 
       for (iloop = 0; iloop < numBits; iloop++)
 	{
@@ -373,21 +360,21 @@ Emergency(unsigned int jtagType, unsigned int numBits, unsigned int *jtagData)
 	  shData = ((jtagData[iword] >> ibit) << 1) & 0x2;
 	  if (iloop == numBits - 1)
 	    shData = shData + 1;	//set the TMS high for last bit to exit Shift_DR
-	  vmeWrite32((vuintptr_t)eJTAGLoad, shData);
+	  vldBus->write32((vuintptr_t)eJTAGLoad, shData);
 	}
 
       // shift _DR tail
-      vmeWrite32((vuintptr_t)eJTAGLoad, 1);	// update Data_Register
-      vmeWrite32((vuintptr_t)eJTAGLoad, 0);	// back to the Run_test/Idle
+      vldBus->write32((vuintptr_t)eJTAGLoad, 1);	// update Data_Register
+      vldBus->write32((vuintptr_t)eJTAGLoad, 0);	// back to the Run_test/Idle
     }
   else if (jtagType == 3)	// JTAG instruction shift, stop at IR-PAUSE state, though, it started from IDLE
     {
       // Shift_IR header:
-      vmeWrite32((vuintptr_t)eJTAGLoad, 0);
-      vmeWrite32((vuintptr_t)eJTAGLoad, 1);
-      vmeWrite32((vuintptr_t)eJTAGLoad, 1);
-      vmeWrite32((vuintptr_t)eJTAGLoad, 0);
-      vmeWrite32((vuintptr_t)eJTAGLoad, 0);
+      vldBus->write32((vuintptr_t)eJTAGLoad, 0);
+      vldBus->write32((vuintptr_t)eJTAGLoad, 1);
+      vldBus->write32((vuintptr_t)eJTAGLoad, 1);
+      vldBus->write32((vuintptr_t)eJTAGLoad, 0);
+      vldBus->write32((vuintptr_t)eJTAGLoad, 0);
 
       for (iloop = 0; iloop < numBits; iloop++)
 	{
@@ -396,21 +383,21 @@ Emergency(unsigned int jtagType, unsigned int numBits, unsigned int *jtagData)
 	  shData = ((jtagData[iword] >> ibit) << 1) & 0x2;
 	  if (iloop == numBits - 1)
 	    shData = shData + 1;	//set the TMS high for last bit to exit Shift_IR
-	  vmeWrite32((vuintptr_t)eJTAGLoad, shData);
+	  vldBus->write32((vuintptr_t)eJTAGLoad, shData);
 	}
 
       // shift _IR tail
-      vmeWrite32((vuintptr_t)eJTAGLoad, 0);	// update instruction register
-      vmeWrite32((vuintptr_t)eJTAGLoad, 0);	// back to the Run_test/Idle
+      vldBus->write32((vuintptr_t)eJTAGLoad, 0);	// update instruction register
+      vldBus->write32((vuintptr_t)eJTAGLoad, 0);	// back to the Run_test/Idle
     }
   else if (jtagType == 4)	// JTAG data shift, start from IR-PAUSE, end at IDLE
     {
       //shift_DR header
-      vmeWrite32((vuintptr_t)eJTAGLoad, 1);	//to EXIT2_IR
-      vmeWrite32((vuintptr_t)eJTAGLoad, 1);	//to UPDATE_IR
-      vmeWrite32((vuintptr_t)eJTAGLoad, 1);	//to SELECT-DR_SCAN
-      vmeWrite32((vuintptr_t)eJTAGLoad, 0);
-      vmeWrite32((vuintptr_t)eJTAGLoad, 0);
+      vldBus->write32((vuintptr_t)eJTAGLoad, 1);	//to EXIT2_IR
+      vldBus->write32((vuintptr_t)eJTAGLoad, 1);	//to UPDATE_IR
+      vldBus->write32((vuintptr_t)eJTAGLoad, 1);	//to SELECT-DR_SCAN
+      vldBus->write32((vuintptr_t)eJTAGLoad, 0);
+      vldBus->write32((vuintptr_t)eJTAGLoad, 0);
 
       for (iloop = 0; iloop < numBits; iloop++)
 	{
@@ -419,19 +406,19 @@ Emergency(unsigned int jtagType, unsigned int numBits, unsigned int *jtagData)
 	  shData = ((jtagData[iword] >> ibit) << 1) & 0x2;
 	  if (iloop == numBits - 1)
 	    shData = shData + 1;	//set the TMS high for last bit to exit Shift_DR
-	  vmeWrite32((vuintptr_t)eJTAGLoad, shData);
+	  vldBus->write32((vuintptr_t)eJTAGLoad, shData);
 	}
 
       // shift _DR tail
-      vmeWrite32((vuintptr_t)eJTAGLoad, 1);	// update Data_Register
-      vmeWrite32((vuintptr_t)eJTAGLoad, 0);	// back to the Run_test/Idle
+      vldBus->write32((vuintptr_t)eJTAGLoad, 1);	// update Data_Register
+      vldBus->write32((vuintptr_t)eJTAGLoad, 0);	// back to the Run_test/Idle
     }
   else if (jtagType == 5)  // JTAG RUNTEST
     {
       //      printf(" real RUNTEST delay %d \n", numBits);
       for (iloop =0; iloop <numBits; iloop++)
 	{
-	  vmeWrite32((vuintptr_t)eJTAGLoad, 0); // Shift TMS=0, TDI=0
+	  vldBus->write32((vuintptr_t)eJTAGLoad, 0); // Shift TMS=0, TDI=0
 	  //	  cpuDelay(100);
 	}
     }
@@ -487,7 +474,7 @@ FirmwareEMload(char *filename)
   unsigned int RegAdd;
   char tempchar;
 #endif
-  char *ShiftChar;
+  static char *ShiftChar = NULL;	// allocated once, and kept for each SDR record
   unsigned int nlongwait = 0, ilongwait = 0;
   unsigned int longwait_threshold = 100000;
 #ifdef DEBUG
@@ -621,9 +608,10 @@ FirmwareEMload(char *filename)
 		    }
 		  else		// deal with the FPGA loading size more than one line: 77845248, 77845248 = 304083*4*8*8
 		    {
-		      ShiftChar =
-			(char *) malloc(shiftChar_size * sizeof(char));
-		      if (ShiftChar <= 0)
+		      if (ShiftChar == NULL)
+			ShiftChar =
+			  (char *) malloc(shiftChar_size * sizeof(char));
+		      if (ShiftChar == NULL)
 			{
 			  printf(" Error Allocating memory for ShiftChar \n");
 
@@ -756,8 +744,6 @@ FirmwareEMload(char *filename)
 #endif
 		      Emergency(2 + extrType, nbits, (unsigned int *)ShiftChar);
 
-		      free(ShiftChar);
-
 		    }
 		}
 	    }
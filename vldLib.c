@@ -16,1267 +16,5960 @@
 /** \cond PRIVATE */
 
 #include <unistd.h>
+#include <stddef.h>
+#include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
 #include <stdio.h>
+#include <time.h>
+#include <sched.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifndef VLD_SIM_ONLY
 #include "jvme.h"
+#endif
 #include "vldLib.h"
 
-/* Mutex to guard register read/writes */
-pthread_mutex_t vldMutex = PTHREAD_MUTEX_INITIALIZER;
-#define VLOCK   if(pthread_mutex_lock(&vldMutex)<0) perror("pthread_mutex_lock");
-#define VUNLOCK if(pthread_mutex_unlock(&vldMutex)<0) perror("pthread_mutex_unlock");
+/* Lock the crate, to guard initialization and the slot tables */
+#define VLOCK								\
+  if(vldCrateLock(crate)!=0)						\
+    vldLog(VLD_LOG_ERROR, VLD_ERR_SYSTEM, -1, "pthread_mutex_lock failed");
+#define VUNLOCK								\
+  if(pthread_mutex_unlock(&crate->st->vldMutex)!=0)			\
+    vldLog(VLD_LOG_ERROR, VLD_ERR_SYSTEM, -1, "pthread_mutex_unlock failed");
+
+/* Lock or unlock, and log if it fails */
+#define VLOCKCALL(_lockfunc, ...)					\
+  if(_lockfunc(__VA_ARGS__)!=0)						\
+    vldLog(VLD_LOG_ERROR, VLD_ERR_SYSTEM, -1, #_lockfunc " failed")
+
+#ifdef VLD_STATS
+/* Statistics of the current call of an instrumented function, in this thread */
+typedef struct vldStatsScope
+{
+  int32_t func;
+  int32_t id;
+  uint64_t start;
+  uint64_t lockStart;
+  uint64_t lockWait;
+  uint64_t lockHold;
+  uint32_t reads;
+  uint32_t writes;
+  uint32_t probes;
+  uint32_t blocks;
+  struct vldStatsScope *prev;
+} vldStatsScope;
+
+static __thread vldStatsScope *vldStatsCur __attribute__((tls_model("initial-exec"))) = NULL;
+static vldStats vldStatsTable[VLD_STATS_NFUNC][MAX_VME_SLOTS+1];
+
+/* Timestamps are in ticks of the time stamp counter, where there is one.
+   Otherwise in ns */
+static uint64_t vldStatsScale = 1ULL << 32;  /* ns per tick, 32.32 fixed point */
+
+static inline uint64_t
+vldStatsMonotonic()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define vldStatsNow()  __builtin_ia32_rdtsc()
+
+/* Measure the time stamp counter frequency, when the library is loaded */
+static void __attribute__((constructor))
+vldStatsCalibrate()
+{
+  struct timespec wait = { 0, 2000000 };
+  uint64_t ns0, ticks0, ns1, ticks1;
+
+  ns0 = vldStatsMonotonic();
+  ticks0 = vldStatsNow();
+  nanosleep(&wait, NULL);
+  ns1 = vldStatsMonotonic();
+  ticks1 = vldStatsNow();
+
+  if(ticks1 > ticks0)
+    vldStatsScale = ((ns1 - ns0) << 32) / (ticks1 - ticks0);
+}
+#else
+#define vldStatsNow()  vldStatsMonotonic()
+#endif
+
+static inline uint64_t
+vldStatsTicksToNs(uint64_t ticks)
+{
+  return (ticks >> 32) * vldStatsScale + (((ticks & 0xFFFFFFFF) * vldStatsScale) >> 32);
+}
+
+static inline void
+vldStatsEnter(vldStatsScope *scope, int32_t func, int32_t id)
+{
+  scope->func = func;
+  scope->id = ((id > 0) && (id <= MAX_VME_SLOTS)) ? id : 0;
+  scope->lockWait = scope->lockHold = 0;
+  scope->reads = scope->writes = scope->probes = scope->blocks = 0;
+  scope->prev = vldStatsCur;
+  vldStatsCur = scope;
+  scope->start = vldStatsNow();
+}
+
+/* Add the call to the table, when the instrumented function returns */
+static void
+vldStatsLeave(vldStatsScope *scope)
+{
+  vldStats *st = &vldStatsTable[scope->func][scope->id];
+  uint64_t elapsed = vldStatsTicksToNs(vldStatsNow() - scope->start);
+  uint32_t bucket = elapsed ? 64 - __builtin_clzll(elapsed) : 0;
+
+  if(bucket >= VLD_STATS_NBUCKETS)
+    bucket = VLD_STATS_NBUCKETS - 1;
+
+  __atomic_fetch_add(&st->calls, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&st->time, elapsed, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&st->latency[bucket], 1, __ATOMIC_RELAXED);
+  if(scope->reads)
+    __atomic_fetch_add(&st->reads, scope->reads, __ATOMIC_RELAXED);
+  if(scope->writes)
+    __atomic_fetch_add(&st->writes, scope->writes, __ATOMIC_RELAXED);
+  if(scope->probes)
+    __atomic_fetch_add(&st->probes, scope->probes, __ATOMIC_RELAXED);
+  if(scope->blocks)
+    __atomic_fetch_add(&st->blocks, scope->blocks, __ATOMIC_RELAXED);
+  if(scope->lockHold)
+    {
+      __atomic_fetch_add(&st->lockWait, vldStatsTicksToNs(scope->lockWait), __ATOMIC_RELAXED);
+      __atomic_fetch_add(&st->lockHold, vldStatsTicksToNs(scope->lockHold), __ATOMIC_RELAXED);
+    }
+
+  vldStatsCur = scope->prev;
+}
+
+/* Instrument the rest of the enclosing function, for the specified slot */
+#define VSTATS(_func, _id)						\
+  vldStatsScope _vstats __attribute__((cleanup(vldStatsLeave)));	\
+  vldStatsEnter(&_vstats, VLD_STATS_##_func, _id)
+#define VSTATS_COUNT(_counter)  ((void)(vldStatsCur ? vldStatsCur->_counter++ : 0))
+#define VSTATS_ADD(_counter, _n)  ((void)(vldStatsCur ? vldStatsCur->_counter += (_n) : 0))
+/* Uncontended locks are taken with a trylock, and need no timestamp for the wait */
+#define VSTATS_LOCK(_lockfunc, _trylockfunc, ...)			\
+  if(vldStatsCur == NULL)						\
+    { VLOCKCALL(_lockfunc, __VA_ARGS__); }				\
+  else if(_trylockfunc(__VA_ARGS__) == 0)				\
+    vldStatsCur->lockStart = vldStatsNow();				\
+  else									\
+    { uint64_t _t0 = vldStatsNow();					\
+      VLOCKCALL(_lockfunc, __VA_ARGS__);				\
+      vldStatsCur->lockStart = vldStatsNow();				\
+      vldStatsCur->lockWait += vldStatsCur->lockStart - _t0; }
+#define VSTATS_UNLOCK							\
+  if(vldStatsCur) vldStatsCur->lockHold += vldStatsNow() - vldStatsCur->lockStart;
+#else
+#define VSTATS(_func, _id)
+#define VSTATS_COUNT(_counter)  ((void)0)
+#define VSTATS_ADD(_counter, _n)  ((void)0)
+#define VSTATS_LOCK(_lockfunc, _trylockfunc, ...)			\
+  VLOCKCALL(_lockfunc, __VA_ARGS__);
+#define VSTATS_UNLOCK
+#endif /* VLD_STATS */
+
+/* Reader/Writer lock of a module, to guard register read/writes */
+#define VSLOCK_RD(_id)							\
+  VSTATS_LOCK(vldSlotLockRd, vldSlotTryLockRd, crate, _id)
+#define VSLOCK_WR(_id)							\
+  VSTATS_LOCK(vldSlotLockWr, vldSlotTryLockWr, crate, _id)
+#define VSUNLOCK(_id)							\
+  VSTATS_UNLOCK								\
+  VLOCKCALL(vldSlotUnlock, crate, _id);
+
+/* Bring the mapping of a shared crate up to date with its slot tables */
+#define VSYNC								\
+  if(crate->shm &&							\
+     (__atomic_load_n(&crate->st->vldTableSeq, __ATOMIC_ACQUIRE) != crate->mapSeq)) \
+    vldCrateSync(crate)
 
 #define CHECKID(id)							\
-  if((id<0) || (id>=MAX_VME_SLOTS) || (VLDp[id] == NULL))		\
+  VSYNC;								\
+  if((id<0) || (id>=MAX_VME_SLOTS) ||					\
+     !(__atomic_load_n(&crate->st->vldSlotPresent, __ATOMIC_ACQUIRE) & (1 << id)))	\
     {									\
-      printf("%s: ERROR : VLD id %d is not initialized \n",		\
-	     __func__, id);						\
+      vldLog(VLD_LOG_ERROR, VLD_ERR_NOT_INITIALIZED, id,			\
+	     "VLD id %d is not initialized", id);			\
       return ERROR;							\
     }
 
+/* Register access through the selected backend */
+#define vldRead32(_addr)         (VSTATS_COUNT(reads), crate->vldBE->read32(_addr))
+#define vldWrite32(_addr, _val)  (VSTATS_COUNT(writes), crate->vldBE->write32(_addr, _val))
+
 /** \endcond */
 
-/* Globals */
-int32_t nVLD = 0;                        /* Number of initialized modules */
-volatile vldRegs *VLDp[MAX_VME_SLOTS+1];  /* pointer to memory maps, index = slotID */
-volatile vldSerialRegs *VLDJTAGp[MAX_VME_SLOTS+1];
-volatile vldSerialRegs *VLDI2Cp[MAX_VME_SLOTS+1];
-int32_t vldID[MAX_VME_SLOTS+1];                    /**< array of slot numbers */
-unsigned long vldA24Offset = 0;          /* Difference in CPU A24 Base and VME A24 Base */
-uint32_t vldAddrList[MAX_VME_SLOTS+1];     /**< array of a24 addresses */
-uint16_t vldFWVers[MAX_VME_SLOTS+1];
 
+#ifndef VLD_SIM_ONLY
+/** \cond PRIVATE */
+/* Hardware backend, using jvme */
+static uint32_t
+vldHwRead32(volatile uint32_t *addr)
+{
+  return vmeRead32(addr);
+}
+
+static void
+vldHwWrite32(volatile uint32_t *addr, uint32_t wval)
+{
+  vmeWrite32(addr, wval);
+}
 
-/**
- * @brief Check the register map
- * @details DEBUG Routine to check the register map with the vldRegs structure
- * @return OK if successful, otherwise ERROR
- */
-int32_t
-vldCheckAddresses()
+static int32_t
+vldHwMemProbe(volatile uint32_t *addr, uint32_t *rval)
 {
-  int32_t rval = OK;
-  uintptr_t offset = 0, expected = 0, base = 0;
-  vldRegs fbase;
+#ifdef VXWORKS
+  return vxMemProbe((char *) addr, VX_READ, 4, (char *) rval);
+#else
+  return vmeMemProbe((char *) addr, 4, (char *) rval);
+#endif
+}
 
-  printf("%s:\n\t ---------- Checking VLD memory map ---------- \n",
-	 __func__);
+static int32_t
+vldHwBusToLocal(uint32_t vmeAddr, uintptr_t *localAddr)
+{
+#ifdef VXWORKS
+  return sysBusToLocalAdrs(0x39, (char *)(unsigned long)vmeAddr, (char **)localAddr);
+#else
+  return vmeBusToLocalAdrs(0x39, (char *)(unsigned long)vmeAddr, (char **)localAddr);
+#endif
+}
 
-  base = (uintptr_t) &fbase;
-/** \cond PRIVATE */
-#ifndef CHECKOFFSET
-#define CHECKOFFSET(_x, _y)						\
-  offset = ((uintptr_t) &fbase._y) - base;				\
-  expected = _x;							\
-  if(offset != expected)						\
-  {									\
-  printf("%s: ERROR ->%s not at offset = 0x%lx (@ 0x%lx)\n",		\
-	 __func__, #_y ,expected, offset);				\
-  rval = ERROR;								\
-  }
+static void
+vldHwSetQuiet(int32_t quiet)
+{
+#ifndef VXWORKS
+  vmeSetQuietFlag(quiet);
 #endif
+}
 /** \endcond */
 
-  CHECKOFFSET(0x0C, trigDelay);
-  CHECKOFFSET(0x68, bleachTime);
-  CHECKOFFSET(0x100, reset);
+const vldBackend vldHardwareBackend =
+  {
+    .name       = "jvme",
+    .read32     = vldHwRead32,
+    .write32    = vldHwWrite32,
+    .memProbe   = vldHwMemProbe,
+    .busToLocal = vldHwBusToLocal,
+    .setQuiet   = vldHwSetQuiet,
+    .maxProbes  = 1,   /* The bridge's bus error status is shared */
+    .blockRead  = NULL, /* The DMA engine, and its buffers, belong to the readout */
+    .chainedRead = NULL, /* The VLD has no CBLT address register */
+  };
+
+#define VLD_DEFAULT_BACKEND  &vldHardwareBackend
+#else
+#define VLD_DEFAULT_BACKEND  &vldSimBackend
+#endif
 
-  return rval;
-}
+/** \cond PRIVATE */
+#define VLD_CACHE_LINE  64
 
-/**
- * @brief Initialize the VLD Library
- *
- * @details Increment through A24 addresses and initialize library
- * with modules that match the VLD boardID and supported firmware version(s).
- *
- * @param[in] addr First address to check
- * @param[in] addr_inc The inc of addr
- * @param[in] nfind number of addr_inc
- *
- * @param[in] iFlag Initialization mask
- *       bit| desc
- *       ---|-------------------------
- *        0 | No module initialization
- *        1 | Skip the firmware check
- *        2 | Increment Using user initialized vldAddrList array
- * @return OK if successful, otherwise ERROR
- */
-int32_t
-vldInit(uint32_t addr, uint32_t addr_inc, uint32_t nfind, uint32_t iFlag)
+/* Each slotID in a mask, lowest first */
+#define VLD_FOREACH_SLOT(_id, _mask)					\
+  for(uint32_t _vm = (_mask); _vm && ((_id = __builtin_ctz(_vm)), 1); _vm &= _vm - 1)
+
+/* History of trigger count samples of a module.
+   Written by the sampler thread, read lock-free by any thread */
+typedef struct
 {
-  int32_t useList=0, noBoardInit=0;
-  int32_t islot, ivld;
-  int32_t res;
-  uint32_t rdata, boardID;
-  uintptr_t laddr, laddr_inc;
-  uint32_t firmwareInfo=0, vldVersion=0, vldType=0;
-  volatile vldRegs *vld;
+  struct
+  {
+    uint64_t seq;          /* odd while the entry is being written */
+    uint64_t index;        /* sample number stored in this entry */
+    vldTriggerSample sample;
+  } entry[VLD_SAMPLER_RING_SIZE];
+  uint64_t head;           /* number of samples written */
+  uint32_t lastRaw;        /* last 32bit trigCnt, for the 64bit extension */
+  uint64_t high;           /* upper bits of the 64bit extension */
+  uint32_t resetSeq;       /* resetSeq of the module, when lastRaw was read */
+} vldSampleRing;
+
+/* Module lock.  A reader/writer lock, or a robust mutex when the crate
+   is shared between processes */
+typedef struct
+{
+  pthread_rwlock_t rw;
+  pthread_mutex_t mx;
+} vldLock;
+
+/* Per module state that is shared between processes.  One cache line
+   aligned entry per slot, so threads working on different modules don't
+   share a line */
+typedef struct
+{
+  vldLock lock;                             /* guards register read/writes */
+  uint32_t a24;                             /* VME A24 address */
+  uint16_t fwVers;
+  uint32_t resetSeq;                        /* incremented when the module is reset or replaced */
+  uint64_t shadowValid;                     /* bit = register offset >> 2 */
+  vldRegs shadow;                           /* Shadow of the configuration registers */
+  uint32_t pubSeq;                          /* odd while published changes */
+  uint64_t pubTime;                         /* ns, CLOCK_MONOTONIC, of the last change */
+  uint64_t pubValid;                        /* words of published that are known, as shadowValid */
+  vldRegs published;                        /* Last known registers, for vldGetPublishedStatus */
+} __attribute__((aligned(VLD_CACHE_LINE))) vldModuleState;
+
+/* Crate state that is shared between processes, with vldCrateAttachShared */
+typedef struct
+{
+  pthread_mutex_t vldMutex;                 /* guards initialization and the slot tables */
 
+  int32_t nVLD;                             /* Number of initialized modules */
+  int32_t vldID[MAX_VME_SLOTS+1];           /* array of slot numbers */
+  uint32_t vldSlotPresent;                  /* mask of the slotIDs in vldID */
+  uint32_t vldTableSeq;                     /* odd while vldID, nVLD, and vldSlotPresent change */
+  uint32_t vldScanAddr[MAX_VME_SLOTS+1];    /* A24 addresses checked by vldInit, for vldRescan */
+  int32_t nScanAddr;
 
-  /* Check if we're skipping initialization, and just mapping the structure pointer */
-  if(iFlag&VLD_INIT_NO_INIT)
+  vldModuleState mod[MAX_VME_SLOTS+1];      /* index = slotID */
+} vldCrateState;
+
+/* Named shared memory segment, with the state of a crate */
+#define VLD_SHARED_MAGIC  0x564c4453  /* "VLDS" */
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t size;                            /* sizeof(vldShared), of the library that created it */
+  uint32_t ready;                           /* set once the state is initialized */
+  vldCrateState state;
+} vldShared;
+
+/* Code paths of a firmware version, selected when a module is initialized */
+typedef struct
+{
+  const char *name;
+  uint32_t firmware;                        /* firmware version.  0 for any other */
+  uint32_t boardType;                       /* boardID bits 31:16.  0 for any VLD type */
+  /* Write a configuration register */
+  void (*write)(vldCrate *crate, int32_t id, volatile uint32_t *reg, uint32_t wval);
+} vldFirmwareOps;
+
+/* Per module state of this process.  One cache line aligned entry per slot */
+typedef struct
+{
+  const vldFirmwareOps *ops;                /* firmware code paths */
+  volatile vldRegs *VLDp;                   /* pointer to memory map */
+  volatile vldSerialRegs *VLDJTAGp;
+  volatile vldSerialRegs *VLDI2Cp;
+
+  /* Staged configuration registers, between vldConfigBegin and vldConfigCommit */
+  int32_t pendingActive;
+  uint64_t pendingDirty;                    /* bit = register offset >> 2 */
+  vldRegs pending;
+
+  vldSampleRing sampler;                    /* Trigger count samples */
+} __attribute__((aligned(VLD_CACHE_LINE))) vldModule;
+
+/* Snapshot of vldGetStatusDelta, for the next call with its token */
+typedef struct
+{
+  uint64_t token;                           /* 0 if not used */
+  uint32_t mask;                            /* slots in base */
+  vldStatus base[MAX_VME_SLOTS+1];          /* index = slotID */
+} vldDeltaBase;
+
+/* Crate context.  The modules of a crate, and their locks */
+struct vldCrate
+{
+  vldCrateState *st;                        /* &local, or the shared segment */
+  vldCrateState local;
+  vldShared *shm;                           /* NULL if not shared */
+  const vldBackend *vldBE;                  /* Register access backend */
+
+  vldModule mod[MAX_VME_SLOTS+1];           /* index = slotID */
+
+  /* Mapping of the modules in this process */
+  unsigned long vldA24Offset;               /* Difference in CPU A24 Base and VME A24 Base */
+  int32_t mapped;                           /* vldA24Offset is known */
+  uint32_t mapSeq;                          /* vldTableSeq that VLDp is up to date with */
+  uint32_t vldAddrList[MAX_VME_SLOTS+1];    /* array of a24 addresses */
+
+  /* Trigger count sampler */
+  pthread_mutex_t samplerMutex;             /* guards starting and stopping the sampler */
+  pthread_t vldSamplerThread;
+  int32_t vldSamplerRunning;
+  int32_t vldSamplerStopFlag;
+  uint32_t vldSamplerPeriod;
+
+  /* Snapshots of vldGetStatusDelta, the latest of each consumer */
+  pthread_mutex_t deltaMutex;
+  uint64_t deltaLast;                       /* latest token returned */
+  vldDeltaBase delta[VLD_DELTA_CONSUMERS];
+};
+
+/* Crate of the original (crate-less) routines */
+static vldCrate vldDefaultCrate =
+  {
+    .st = &vldDefaultCrate.local,
+    .local =
     {
-      noBoardInit = 1;
-    }
+      .vldMutex = PTHREAD_MUTEX_INITIALIZER,
+      .mod =
+      { [0 ... MAX_VME_SLOTS] = { .lock = { PTHREAD_RWLOCK_INITIALIZER, PTHREAD_MUTEX_INITIALIZER } } },
+    },
+    .vldBE = VLD_DEFAULT_BACKEND,
+    .samplerMutex = PTHREAD_MUTEX_INITIALIZER,
+    .deltaMutex = PTHREAD_MUTEX_INITIALIZER,
+  };
+
+static void vldTablePublish(vldCrate *crate, const int32_t *slots, int32_t nslots);
+static const vldFirmwareOps *vldFirmwareSelect(uint32_t firmware, uint32_t boardID);
+
+/* Lock the crate.  If a process died holding it, repair the slot tables */
+static int
+vldCrateLock(vldCrate *crate)
+{
+  vldCrateState *st = crate->st;
+  int32_t slots[MAX_VME_SLOTS+1], nslots = 0, islot;
+  int rval;
 
-  /* Check if we're initializing using a list */
-  if(iFlag&VLD_INIT_USE_ADDR_LIST)
+  rval = pthread_mutex_lock(&st->vldMutex);
+  if(rval != EOWNERDEAD)
+    return rval;
+
+  vldLog(VLD_LOG_WARN, VLD_ERR_SYSTEM, -1, "Crate lock owner died, recovering");
+  if(st->vldTableSeq & 1)
     {
-      useList=1;
+      /* Died while changing the slot tables.  Keep the modules in vldSlotPresent */
+      VLD_FOREACH_SLOT(islot, st->vldSlotPresent)
+	slots[nslots++] = islot;
+      __atomic_store_n(&st->vldTableSeq, st->vldTableSeq + 1, __ATOMIC_RELEASE);
+      vldTablePublish(crate, slots, nslots);
     }
 
-  /* Check for valid address */
-  if( (addr==0) && (useList==0) )
-    { /* Scan through valid slot -> A24 address */
-      useList=1;
-      nfind=16;
-
-      /* Loop through JLab VXS Weiner Crate GEOADDR to VME addresses to make a list */
-      for(islot=3; islot<11; islot++) /* First 8 */
-	vldAddrList[islot-3] = (islot<<19);
+  return pthread_mutex_consistent(&st->vldMutex);
+}
 
-      /* Skip Switch Slots */
+/* Result of taking the robust lock of a module.  If a process died holding it,
+   the registers may not match the shadow */
+static int
+vldSlotLockResult(vldCrate *crate, int32_t id, int rval)
+{
+  if(rval != EOWNERDEAD)
+    return rval;
 
-      for(islot=13; islot<21; islot++) /* Last 8 */
-	vldAddrList[islot-5] = (islot<<19);
+  vldLog(VLD_LOG_WARN, VLD_ERR_SYSTEM, id, "Module lock owner died, shadow invalidated");
+  __atomic_and_fetch(&crate->st->mod[id].shadowValid, 1ULL, __ATOMIC_RELEASE);
+  if(crate->st->mod[id].pubSeq & 1)
+    __atomic_store_n(&crate->st->mod[id].pubSeq, crate->st->mod[id].pubSeq + 1, __ATOMIC_RELEASE);
 
-    }
-  else if(addr > 0x00ffffff)
-    { /* A32 Addressing */
-      printf("%s: ERROR: A32 Addressing not allowed for VLD configuration space\n",
-	     __func__);
-      return(ERROR);
-    }
-  else
-    { /* A24 Addressing */
-      if(addr < 22)
-	{ /* First argument is a slot number, instead of VME address */
-	  printf("%s: Initializing using slot number %d (VME address 0x%x)\n",
-		 __func__,addr,addr<<19);
-	  addr = addr<<19; // Shift to VME A24 address;
+  return pthread_mutex_consistent(&crate->st->mod[id].lock.mx);
+}
 
-	  /* If addr_inc is also in slot number form, shift it */
-	  if((addr_inc<22) && (addr_inc>0))
-	    addr_inc = addr_inc<<19;
+/* Module locks.  Reader/writer locks, or robust mutexes in a shared crate */
+static int
+vldSlotLockRd(vldCrate *crate, int32_t id)
+{
+  if(crate->shm)
+    return vldSlotLockResult(crate, id, pthread_mutex_lock(&crate->st->mod[id].lock.mx));
+  return pthread_rwlock_rdlock(&crate->st->mod[id].lock.rw);
+}
 
-	  /* Check and shift the address list, if it's used */
-	  if(useList==1)
-	    {
-	      for(ivld=0; ivld<nfind; ivld++)
-		{
-		  if(vldAddrList[ivld] < 22)
-		    {
-		      vldAddrList[ivld] = vldAddrList[ivld]<<19;
-		    }
-		}
-	    }
-	}
+static int
+vldSlotLockWr(vldCrate *crate, int32_t id)
+{
+  if(crate->shm)
+    return vldSlotLockResult(crate, id, pthread_mutex_lock(&crate->st->mod[id].lock.mx));
+  return pthread_rwlock_wrlock(&crate->st->mod[id].lock.rw);
+}
 
-      if( ((addr_inc==0)||(nfind==0)) && (useList==0) )
-	{ /* assume only one VLD to initialize */
-	  nfind = 1;
-	}
-    }
+#ifdef VLD_STATS
+/* Taking an uncontended lock, for the lock wait statistics (VSTATS_LOCK) */
+static int
+vldSlotTryLockRd(vldCrate *crate, int32_t id)
+{
+  if(crate->shm)
+    return vldSlotLockResult(crate, id, pthread_mutex_trylock(&crate->st->mod[id].lock.mx));
+  return pthread_rwlock_tryrdlock(&crate->st->mod[id].lock.rw);
+}
 
-  /* get the VLD address */
-#ifdef VXWORKS
-  res = sysBusToLocalAdrs(0x39,(char *)(unsigned long)addr,(char **)&laddr);
-#else
-  res = vmeBusToLocalAdrs(0x39,(char *)(unsigned long)addr,(char **)&laddr);
+static int
+vldSlotTryLockWr(vldCrate *crate, int32_t id)
+{
+  if(crate->shm)
+    return vldSlotLockResult(crate, id, pthread_mutex_trylock(&crate->st->mod[id].lock.mx));
+  return pthread_rwlock_trywrlock(&crate->st->mod[id].lock.rw);
+}
 #endif
 
-#ifndef SHOWERROR
-#ifndef VXWORKS
-  vmeSetQuietFlag(1);
-#endif
-#endif
+static int
+vldSlotUnlock(vldCrate *crate, int32_t id)
+{
+  if(crate->shm)
+    return pthread_mutex_unlock(&crate->st->mod[id].lock.mx);
+  return pthread_rwlock_unlock(&crate->st->mod[id].lock.rw);
+}
 
-  if (res != 0)
+/* Map the modules of a shared crate, that were added by another process */
+static void
+vldCrateSync(vldCrate *crate)
+{
+  vldCrateState *st = crate->st;
+  uint32_t seq, present;
+  uintptr_t laddr;
+  int32_t islot;
+
+  /* Wait for a change of the slot tables, or repair it if its process died */
+  while((seq = __atomic_load_n(&st->vldTableSeq, __ATOMIC_ACQUIRE)) & 1)
     {
-#ifdef VXWORKS
-      printf("%s: ERROR in sysBusToLocalAdrs(0x39,0x%x,&laddr) \n",
-	     __func__,addr);
-#else
-      printf("%s: ERROR in vmeBusToLocalAdrs(0x39,0x%x,&laddr) \n",
-	     __func__,addr);
-#endif
-      return(ERROR);
+      VLOCK;
+      VUNLOCK;
     }
-  vldA24Offset = laddr - addr;
 
-  for (ivld=0;ivld<nfind;ivld++)
+  if(!crate->mapped && (st->nScanAddr > 0) &&
+     (crate->vldBE->busToLocal(st->vldScanAddr[0], &laddr) == 0))
     {
-      if(useList==1)
-	{
-	  laddr_inc = vldAddrList[ivld] + vldA24Offset;
-	}
-      else
+      crate->vldA24Offset = laddr - st->vldScanAddr[0];
+      crate->mapped = 1;
+    }
+
+  if(crate->mapped)
+    {
+      present = __atomic_load_n(&st->vldSlotPresent, __ATOMIC_ACQUIRE);
+      VLD_FOREACH_SLOT(islot, present)
 	{
-	  laddr_inc = laddr +ivld*addr_inc;
+	  crate->mod[islot].VLDp = (vldRegs *)(st->mod[islot].a24 + crate->vldA24Offset);
+	  crate->mod[islot].ops = vldFirmwareSelect(st->mod[islot].fwVers,
+						    st->mod[islot].shadow.boardID);
 	}
+    }
 
-      vld = (vldRegs *)laddr_inc;
-      /* Check if Board exists at that address */
-#ifdef VXWORKS
-      res = vxMemProbe((char *) &(vld->boardID),VX_READ,4,(char *)&rdata);
-#else
-      res = vmeMemProbe((char *) &(vld->boardID),4,(char *)&rdata);
-#endif
+  __atomic_store_n(&crate->mapSeq, seq, __ATOMIC_RELEASE);
+}
+/** \endcond */
 
-      if(res < 0)
-	{
-#ifdef SHOWERRORS
-#ifdef VXWORKS
-	  printf("%s: ERROR: No addressable board at addr=0x%x\n",
-		 __func__,(UINT32) vld);
-#else
-	  printf("%s: ERROR: No addressable board at VME (Local) addr=0x%x (0x%x)\n",
-		 __func__,
-		 (UINT32) laddr_inc-vldA24Offset, (UINT32) vld);
-#endif
-#endif /* SUPPRESSERRORSES */
-	}
-      else
-	{
-	  /* Check that it is a VLD */
-	  if(((rdata&VLD_BOARDID_TYPE_MASK)>>16) != VLD_BOARDID_TYPE_VLD)
-	    {
-	      printf(" WARN: For board at VME addr=0x%x, Invalid Board ID: 0x%x\n",
-		     (UINT32)(laddr_inc - vldA24Offset), rdata);
-	      continue;
-	    }
-	  else
-	    {
-	      /* Check if this is board has a valid slot number */
-	      boardID =  (rdata&VLD_BOARDID_GEOADR_MASK)>>8;
-	      if((boardID <= 0)||(boardID >21))
-		{
-		  printf(" WARN: Board Slot ID is not in range: %d (this module ignored)\n"
-			 ,boardID);
-		  continue;
-		}
-	      else
-		{
-		  VLDp[boardID] = (vldRegs *)(laddr_inc);
-		  vldID[nVLD] = boardID;
-		  unsigned long fwaddr = (unsigned long) (laddr_inc + 0x7c);
-		  firmwareInfo = vmeRead32((volatile uint32_t *)fwaddr) & VLD_FIRMWARE_ID_MASK;
-		  vldFWVers[boardID] = firmwareInfo;
+/* Address list for vldInit, with VLD_INIT_USE_ADDR_LIST */
+uint32_t vldAddrList[MAX_VME_SLOTS+1];     /**< array of a24 addresses */
 
-		  if(firmwareInfo <= 0)
-		    {
-		      printf("%s:  ERROR: Invalid firmware 0x%08x\n",
-			     __func__,firmwareInfo);
-		      return ERROR;
-		    }
+/** \cond PRIVATE */
+/* Replace the slot tables, with vldMutex held.  Readers never see part of the change */
+static void
+vldTablePublish(vldCrate *crate, const int32_t *slots, int32_t nslots)
+{
+  int32_t islot;
+  uint32_t present = 0;
 
-		  printf("Initialized VLD %2d  FW 0x%2x Slot #%d at address 0x%08lx (0x%08x) \n",
-			 nVLD, firmwareInfo, vldID[nVLD],
-			 (unsigned long) VLDp[(vldID[nVLD])],
-			 (uint32_t)((unsigned long)VLDp[(vldID[nVLD])]-vldA24Offset));
-		}
-	    }
-	  nVLD++;
-	}
-    }
+  for(islot = 0; islot < nslots; islot++)
+    present |= (1 << slots[islot]);
 
-#ifndef SHOWERROR
-#ifndef VXWORKS
-  vmeSetQuietFlag(0);
-#endif
-#endif
+  __atomic_store_n(&crate->st->vldTableSeq, crate->st->vldTableSeq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
 
-  if(noBoardInit)
+  for(islot = 0; islot < nslots; islot++)
+    __atomic_store_n(&crate->st->vldID[islot], slots[islot], __ATOMIC_RELAXED);
+  __atomic_store_n(&crate->st->nVLD, nslots, __ATOMIC_RELAXED);
+  __atomic_store_n(&crate->st->vldSlotPresent, present, __ATOMIC_RELAXED);
+
+  __atomic_store_n(&crate->st->vldTableSeq, crate->st->vldTableSeq + 1, __ATOMIC_RELEASE);
+}
+
+/* Consistent copy of the slot tables.  Returns the number of slots */
+static int32_t
+vldTableCopy(vldCrate *crate, int32_t *slots)
+{
+  uint32_t seq;
+  int32_t islot, nslots;
+
+  do
     {
-      if(nVLD>0)
+      while((seq = __atomic_load_n(&crate->st->vldTableSeq, __ATOMIC_ACQUIRE)) & 1)
 	{
-	  printf("%s: %d VLD(s) successfully mapped (not initialized)\n",
-		 __func__,nVLD);
-	  return OK;
+	  if(crate->shm)
+	    {
+	      /* The lock is held by the writer, or repairs the tables if it died */
+	      VLOCK;
+	      VUNLOCK;
+	    }
 	}
+      nslots = __atomic_load_n(&crate->st->nVLD, __ATOMIC_RELAXED);
+      if(nslots > MAX_VME_SLOTS + 1)
+	nslots = MAX_VME_SLOTS + 1;
+      for(islot = 0; islot < nslots; islot++)
+	slots[islot] = __atomic_load_n(&crate->st->vldID[islot], __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
     }
+  while(__atomic_load_n(&crate->st->vldTableSeq, __ATOMIC_RELAXED) != seq);
+
+  return nslots;
+}
+
+/* Add a slot to the end of the tables, if it's not already there */
+static void
+vldTableAdd(vldCrate *crate, int32_t id)
+{
+  int32_t slots[MAX_VME_SLOTS+1];
+
+  if(crate->st->vldSlotPresent & (1 << id))
+    return;
+
+  memcpy(slots, crate->st->vldID, crate->st->nVLD * sizeof(int32_t));
+  slots[crate->st->nVLD] = id;
+  vldTablePublish(crate, slots, crate->st->nVLD + 1);
+}
+/** \endcond */
+
+
+/** \cond PRIVATE */
+/* The register map of VLD_REGISTERS is the map of vldRegs */
+#define VLD_CHECK_OFFSET(_offset, _reg, _group, _access)		\
+  _Static_assert(offsetof(vldRegs, _reg) == _offset,			\
+		 "vldRegs." #_reg " not at offset " #_offset);
+VLD_REGISTERS(VLD_CHECK_OFFSET)
+
+/* and the register masks are those of VLD_FIELDS */
+_Static_assert(LED_CONTROL_CH_ENABLE_MASK == VLD_FIELD_MASK(ledLow, CHANNELS), "ledLow");
+_Static_assert(LED_CONTROL_BLEACH_CTRL_MASK == VLD_FIELD_MASK(ledLow, BLEACH_CTRL), "ledLow");
+_Static_assert(LED_CONTROL_BLEACH_ENABLE_MASK == VLD_FIELD_MASK(ledLow, BLEACH_ENABLE), "ledLow");
+_Static_assert(VLD_BOARDID_TYPE_MASK == VLD_FIELD_MASK(boardID, TYPE), "boardID");
+_Static_assert(VLD_BOARDID_GEOADR_MASK == VLD_FIELD_MASK(boardID, GEOADR), "boardID");
+_Static_assert(VLD_BOARDID_CRATEID_MASK == VLD_FIELD_MASK(boardID, CRATEID), "boardID");
+_Static_assert(VLD_TRIGDELAY_DELAY_MASK == VLD_FIELD_MASK(trigDelay, DELAY), "trigDelay");
+_Static_assert(VLD_TRIGDELAY_16NS_STEP_ENABLE == VLD_FIELD_MASK(trigDelay, STEP16NS), "trigDelay");
+_Static_assert(VLD_TRIGDELAY_WIDTH_MASK == VLD_FIELD_MASK(trigDelay, WIDTH), "trigDelay");
+_Static_assert(VLD_TRIGSRC_MASK == (VLD_FIELD_MASK(trigSrc, PERIODIC) | VLD_FIELD_MASK(trigSrc, RANDOM) |
+				   VLD_FIELD_MASK(trigSrc, SEQUENCE) | VLD_FIELD_MASK(trigSrc, EXTERNAL)),
+	       "trigSrc");
+_Static_assert(VLD_CLOCK_MASK == VLD_FIELD_MASK(clockSrc, SOURCE), "clockSrc");
+_Static_assert(VLD_BLEACHTIME_TIMER_MASK == VLD_FIELD_MASK(bleachTime, TIMER), "bleachTime");
+_Static_assert(VLD_BLEACHTIME_ENABLE_MASK == VLD_FIELD_MASK(bleachTime, ENABLE), "bleachTime");
+_Static_assert(VLD_PULSELOAD_DAC_D_MASK == VLD_FIELD_MASK(pulseLoad, DAC), "pulseLoad");
+_Static_assert(VLD_PULSELOAD_DAC_D_ZERO == VLD_FIELD_MASK(pulseLoad, DAC_ZERO), "pulseLoad");
+_Static_assert(VLD_PULSELOAD_GEN_TRIG == VLD_FIELD_MASK(pulseLoad, GEN_TRIG), "pulseLoad");
+_Static_assert(VLD_CALIBRATIONWIDTH_MASK == VLD_FIELD_MASK(calibrationWidth, WIDTH), "calibrationWidth");
+_Static_assert(VLD_ANALOGCTRL_DELAY_MASK == VLD_FIELD_MASK(analogCtrl, DELAY), "analogCtrl");
+_Static_assert(VLD_ANALOGCTRL_RESERVED == VLD_FIELD_MASK(analogCtrl, RESERVED), "analogCtrl");
+_Static_assert(VLD_ANALOGCTRL_WIDTH_MASK == VLD_FIELD_MASK(analogCtrl, WIDTH), "analogCtrl");
+_Static_assert(VLD_RANDOMTRIG_PRESCALE_MASK == VLD_FIELD_MASK(randomTrig, PRESCALE), "randomTrig");
+_Static_assert(VLD_RANDOMTRIG_ENABLE == VLD_FIELD_MASK(randomTrig, ENABLE), "randomTrig");
+_Static_assert(VLD_PERIODICTRIG_NPULSES_MASK == VLD_FIELD_MASK(periodicTrig, NPULSES), "periodicTrig");
+_Static_assert(VLD_PERIODICTRIG_PERIOD_MASK == VLD_FIELD_MASK(periodicTrig, PERIOD), "periodicTrig");
+_Static_assert(VLD_TRIGCNT_MASK == VLD_FIELD_MASK(trigCnt, COUNT), "trigCnt");
+_Static_assert(VLD_RESET_MASK == (VLD_FIELD_MASK(reset, I2C) | VLD_FIELD_MASK(reset, JTAG) |
+				 VLD_FIELD_MASK(reset, SOFT) | VLD_FIELD_MASK(reset, CLK) |
+				 VLD_FIELD_MASK(reset, MGT) | VLD_FIELD_MASK(reset, HARD_CLK)),
+	       "reset");
+
+/* The register and field tables, for vldCheckAddresses and vldGStatus */
+static const struct
+{
+  uint32_t offset;
+  uint32_t actual;      /* offset in vldRegs */
+  const char *name;
+  const char *group;
+  uint32_t access;
+} vldRegTable[] =
+  {
+#define VLD_REG_ENTRY(_offset, _reg, _group, _access)			\
+    { _offset, offsetof(vldRegs, _reg), #_reg, #_group, _access },
+    VLD_REGISTERS(VLD_REG_ENTRY)
+#undef VLD_REG_ENTRY
+  };
+#define VLD_REG_NREG (sizeof(vldRegTable)/sizeof(vldRegTable[0]))
+
+static const struct
+{
+  const char *group;
+  const char *name;
+  uint32_t shift;
+  uint32_t width;
+} vldFieldTable[] =
+  {
+#define VLD_FIELD_ENTRY(_group, _field, _shift, _width)		\
+    { #_group, #_field, _shift, _width },
+    VLD_FIELDS(VLD_FIELD_ENTRY)
+#undef VLD_FIELD_ENTRY
+  };
+#define VLD_FIELD_NFIELD (sizeof(vldFieldTable)/sizeof(vldFieldTable[0]))
+
+/* Readable words of the register image (the last word, reset, is write only) */
+#define VLD_READABLE_WORD(_offset, _reg, _group, _access)		\
+  | ((((_access) & VLD_REG_RO) && (((_offset) >> 2) < 64)) ? (1ULL << (((_offset) >> 2) & 63)) : 0)
+static const uint64_t vldReadableWords = 0 VLD_REGISTERS(VLD_READABLE_WORD);
+
+/* Return ERROR from the calling routine, if _val doesn't fit in the field */
+#define VLD_CHECK_FIELD(_group, _field, _val, _name)			\
+  if(!vldValid_##_group##_##_field(_val))				\
+    {									\
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, id,			\
+	     "Invalid %s (0x%x).  Max = 0x%x", _name, (uint32_t)(_val),	\
+	     VLD_FIELD_MAX(_group, _field));				\
+      return ERROR;							\
+    }
+
+/* Registers that are cached in the shadow (everything but FIFOs, counters, and resets),
+   in the order they are written by vldConfigCommit, with the bits that may be set */
+static const struct
+{
+  uint32_t offset;
+  uint32_t mask;
+} vldShadowReg[] =
+  {
+    { 0x00, 0x00000000 }, /* boardID, read only */
+    { 0x2C, VLD_CLOCK_MASK },
+    { 0x0C, VLD_TRIGDELAY_DELAY_MASK | VLD_TRIGDELAY_16NS_STEP_ENABLE | VLD_TRIGDELAY_WIDTH_MASK },
+    { 0x70, VLD_CALIBRATIONWIDTH_MASK },
+    { 0x74, VLD_ANALOGCTRL_DELAY_MASK | VLD_ANALOGCTRL_RESERVED | VLD_ANALOGCTRL_WIDTH_MASK },
+    { 0x44, LED_CONTROL_CH_ENABLE_MASK },
+    { 0x40, 0xFFFFFFFF & ~0x00F80000 },
+    { 0x4C, LED_CONTROL_CH_ENABLE_MASK },
+    { 0x48, 0xFFFFFFFF & ~0x00F80000 },
+    { 0x54, LED_CONTROL_CH_ENABLE_MASK },
+    { 0x50, 0xFFFFFFFF & ~0x00F80000 },
+    { 0x5C, LED_CONTROL_CH_ENABLE_MASK },
+    { 0x58, 0xFFFFFFFF & ~0x00F80000 },
+    { 0x64, LED_CONTROL_CH_ENABLE_MASK },
+    { 0x60, 0xFFFFFFFF & ~0x00F80000 },
+    { 0x68, VLD_BLEACHTIME_TIMER_MASK | VLD_BLEACHTIME_ENABLE_MASK },
+    { 0x88, VLD_RANDOMTRIG_PRESCALE_MASK | (VLD_RANDOMTRIG_PRESCALE_MASK << 4) | VLD_RANDOMTRIG_ENABLE },
+    { 0x8C, VLD_PERIODICTRIG_NPULSES_MASK | VLD_PERIODICTRIG_PERIOD_MASK },
+    { 0x20, VLD_TRIGSRC_MASK }  /* last, so triggers are enabled on a configured module */
+  };
+#define VLD_SHADOW_NREG (sizeof(vldShadowReg)/sizeof(vldShadowReg[0]))
+#define VLD_SHADOW_WORD(_id, _iword) (((volatile uint32_t *)&crate->st->mod[_id].shadow)[_iword])
+#define VLD_PENDING_WORD(_id, _iword) (((volatile uint32_t *)&crate->mod[_id].pending)[_iword])
+#define VLD_PUBLISHED_WORD(_id, _iword) (((uint32_t *)&crate->st->mod[_id].published)[_iword])
+
+/* The last known registers of each module are published for
+   vldGetPublishedStatus, which takes no locks.  Writers hold the module lock
+   (read or write), so more than one may publish at once: each makes pubSeq
+   odd, from even, before changing the image, and even again after */
+static inline uint32_t
+vldPublishBegin(vldModuleState *ms)
+{
+  uint32_t seq;
+
+  do
+    seq = __atomic_load_n(&ms->pubSeq, __ATOMIC_RELAXED) & ~1U;
+  while(!__atomic_compare_exchange_n(&ms->pubSeq, &seq, seq + 1, 0,
+				     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+  /* The odd pubSeq is seen before any of the words */
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  return seq + 1;
+}
+
+static inline void
+vldPublishEnd(vldModuleState *ms, uint32_t seq, uint64_t now)
+{
+  __atomic_store_n(&ms->pubTime, now, __ATOMIC_RELAXED);
+  __atomic_store_n(&ms->pubSeq, seq + 1, __ATOMIC_RELEASE);
+}
+
+static inline uint64_t
+vldPublishNow()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Publish nwords of a module, from register word iword.  Only the readable
+   words in mask are changed, and they are then known */
+static void
+vldPublish(vldCrate *crate, int32_t id, uint32_t iword, const uint32_t *words, uint32_t nwords,
+	   uint64_t mask)
+{
+  vldModuleState *ms = &crate->st->mod[id];
+  uint64_t now = vldPublishNow(), known = 0;
+  uint32_t seq, iw, word;
+
+  mask &= vldReadableWords;
+
+  seq = vldPublishBegin(ms);
+  for(iw = 0; iw < nwords; iw++)
+    {
+      word = iword + iw;
+      if((word < 64) && ((mask >> word) & 1))
+	{
+	  __atomic_store_n(&VLD_PUBLISHED_WORD(id, word), words[iw], __ATOMIC_RELAXED);
+	  known |= 1ULL << word;
+	}
+    }
+  __atomic_store_n(&ms->pubValid, ms->pubValid | known, __ATOMIC_RELAXED);
+  vldPublishEnd(ms, seq, now);
+}
+
+/* Clear the published image of a module, newly found with boardID.
+   Only boardID is known */
+static void
+vldPublishReset(vldCrate *crate, int32_t id, uint32_t boardID)
+{
+  vldModuleState *ms = &crate->st->mod[id];
+  uint64_t now = vldPublishNow();
+  uint32_t seq, iword;
+
+  seq = vldPublishBegin(ms);
+  for(iword = 0; iword < (sizeof(vldRegs) >> 2); iword++)
+    __atomic_store_n(&VLD_PUBLISHED_WORD(id, iword), (iword == 0) ? boardID : 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&ms->pubValid, 1ULL, __ATOMIC_RELAXED);
+  vldPublishEnd(ms, seq, now);
+}
+
+/* Write a register of a firmware with a known register map */
+static void
+vldRegWrite(vldCrate *crate, int32_t id, volatile uint32_t *reg, uint32_t wval)
+{
+  vldWrite32(reg, wval);
+}
+
+/* Write a register, and check the bits that may be set, in its readback */
+static void
+vldRegWriteVerify(vldCrate *crate, int32_t id, volatile uint32_t *reg, uint32_t wval)
+{
+  uint32_t offset = (uintptr_t)reg - (uintptr_t)crate->mod[id].VLDp, rval, ireg;
+
+  vldWrite32(reg, wval);
+  rval = vldRead32(reg);
+
+  if((rval & VLD_BADADDR_MASK) == VLD_BADADDR)
+    {
+      vldLog(VLD_LOG_WARN, VLD_ERR_BUS, id,
+	     "Register 0x%02x is not implemented (0x%08x)", offset, rval);
+      return;
+    }
+
+  for(ireg = 0; ireg < VLD_SHADOW_NREG; ireg++)
+    {
+      if((vldShadowReg[ireg].offset == offset) &&
+	 ((rval ^ wval) & vldShadowReg[ireg].mask))
+	vldLog(VLD_LOG_WARN, VLD_ERR_BUS, id,
+	       "Register 0x%02x readback 0x%08x, wrote 0x%08x", offset, rval, wval);
+    }
+}
+
+/* Firmware versions from NPSVLDfirmwareHistory.txt */
+static const vldFirmwareOps vldFirmwareTable[] =
+  {
+    { "V2.2", 0x22, VLD_BOARDID_TYPE_VLD_V22, vldRegWrite },
+    { "V2.4", 0x24, VLD_BOARDID_TYPE_VLD, vldRegWrite },
+  };
+#define VLD_FIRMWARE_NOPS (sizeof(vldFirmwareTable)/sizeof(vldFirmwareTable[0]))
+
+/* Any other version.  Each configuration write is read back */
+static const vldFirmwareOps vldFirmwareDefault =
+  { "unknown", 0, 0, vldRegWriteVerify };
+
+/* Whether a boardID is from a VLD, of any firmware */
+static inline int32_t
+vldBoardIsVLD(uint32_t boardID)
+{
+  uint32_t type = vldDecode_boardID_TYPE(boardID);
+
+  return (type == VLD_BOARDID_TYPE_VLD) || (type == VLD_BOARDID_TYPE_VLD_V22);
+}
+
+/* Code paths for a module, from its firmware version and boardID */
+static const vldFirmwareOps *
+vldFirmwareSelect(uint32_t firmware, uint32_t boardID)
+{
+  uint32_t iops;
+
+  for(iops = 0; iops < VLD_FIRMWARE_NOPS; iops++)
+    {
+      if(vldFirmwareTable[iops].firmware != firmware)
+	continue;
+
+      if(vldFirmwareTable[iops].boardType == vldDecode_boardID_TYPE(boardID))
+	return &vldFirmwareTable[iops];
+
+      vldLog(VLD_LOG_WARN, VLD_ERR_NO_MODULE, vldDecode_boardID_GEOADR(boardID),
+	     "Firmware %s with boardID 0x%08x, using the %s code paths",
+	     vldFirmwareTable[iops].name, boardID, vldFirmwareDefault.name);
+      break;
+    }
+
+  return &vldFirmwareDefault;
+}
+
+/* Write a configuration register, and update its shadow */
+static inline void
+vldCacheWriteNow(vldCrate *crate, int32_t id, volatile uint32_t *reg, uint32_t wval)
+{
+  uint32_t iword = ((uintptr_t)reg - (uintptr_t)crate->mod[id].VLDp) >> 2;
+
+  crate->mod[id].ops->write(crate, id, reg, wval);
+  VLD_SHADOW_WORD(id, iword) = wval;
+  __atomic_fetch_or(&crate->st->mod[id].shadowValid, 1ULL << iword, __ATOMIC_RELEASE);
+  vldPublish(crate, id, iword, &wval, 1, ~0ULL);
+}
+
+/* Write a configuration register, or stage it if a configuration transaction is open */
+static inline void
+vldCacheWrite(vldCrate *crate, int32_t id, volatile uint32_t *reg, uint32_t wval)
+{
+  uint32_t iword;
+
+  if(crate->mod[id].pendingActive)
+    {
+      iword = ((uintptr_t)reg - (uintptr_t)crate->mod[id].VLDp) >> 2;
+      VLD_PENDING_WORD(id, iword) = wval;
+      crate->mod[id].pendingDirty |= 1ULL << iword;
+      return;
+    }
+
+  vldCacheWriteNow(crate, id, reg, wval);
+}
+
+/* Read a configuration register from its shadow, if it's valid.  Otherwise
+   from the module, into the shadow */
+static inline uint32_t
+vldShadowRead(vldCrate *crate, int32_t id, volatile uint32_t *reg)
+{
+  uint32_t iword = ((uintptr_t)reg - (uintptr_t)crate->mod[id].VLDp) >> 2;
+  uint32_t rval;
+
+  if(__atomic_load_n(&crate->st->mod[id].shadowValid, __ATOMIC_ACQUIRE) & (1ULL << iword))
+    return VLD_SHADOW_WORD(id, iword);
+
+  rval = vldRead32(reg);
+  VLD_SHADOW_WORD(id, iword) = rval;
+  __atomic_fetch_or(&crate->st->mod[id].shadowValid, 1ULL << iword, __ATOMIC_RELEASE);
+  vldPublish(crate, id, iword, &rval, 1, ~0ULL);
+
+  return rval;
+}
+
+/* Read a configuration register from its staged value, if a configuration
+   transaction changed it.  Otherwise as vldShadowRead */
+static inline uint32_t
+vldCacheRead(vldCrate *crate, int32_t id, volatile uint32_t *reg)
+{
+  uint32_t iword = ((uintptr_t)reg - (uintptr_t)crate->mod[id].VLDp) >> 2;
+
+  if(crate->mod[id].pendingActive && (crate->mod[id].pendingDirty & (1ULL << iword)))
+    return VLD_PENDING_WORD(id, iword);
+
+  return vldShadowRead(crate, id, reg);
+}
+/** \endcond */
+
+
+/**
+ * @brief Check the register map
+ * @details DEBUG Routine to check the register map with the vldRegs structure
+ * @return OK if successful, otherwise ERROR
+ */
+int32_t
+vldCheckAddresses()
+{
+  int32_t rval = OK;
+  uint32_t ireg;
+
+  printf("%s:\n\t ---------- Checking VLD memory map ---------- \n",
+	 __func__);
+
+  /* Also checked at compile time */
+  for(ireg = 0; ireg < VLD_REG_NREG; ireg++)
+    {
+      if(vldRegTable[ireg].actual != vldRegTable[ireg].offset)
+	{
+	  printf("%s: ERROR ->%s not at offset = 0x%x (@ 0x%x)\n",
+		 __func__, vldRegTable[ireg].name,
+		 vldRegTable[ireg].offset, vldRegTable[ireg].actual);
+	  rval = ERROR;
+	}
+    }
+
+  return rval;
+}
+
+/**
+ * @brief Select the register access backend
+ * @details Select the backend used for all VME register access.  Must be
+ * called before vldInit.  The default is the jvme hardware backend
+ * (vldHardwareBackend), or the simulated crate (vldSimBackend) when
+ * built with VLD_SIM_ONLY.
+ * @param[in] crate Crate context
+ * @param[in] backend Register access backend
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateSetBackend(vldCrate *crate, const vldBackend *backend)
+{
+  if((backend == NULL) || (backend->read32 == NULL) || (backend->write32 == NULL) ||
+     (backend->memProbe == NULL) || (backend->busToLocal == NULL) ||
+     (backend->setQuiet == NULL))
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid backend");
+      return ERROR;
+    }
+
+  VLOCK;
+  if(crate->st->nVLD > 0)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_BAD_STATE, -1,
+	     "Backend must be selected before vldInit");
+      VUNLOCK;
+      return ERROR;
+    }
+  crate->vldBE = backend;
+  VUNLOCK;
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateSetBackend, for the default crate
+ */
+int32_t
+vldSetBackend(const vldBackend *backend)
+{
+  return vldCrateSetBackend(&vldDefaultCrate, backend);
+}
+
+/**
+ * @brief Return the register access backend
+ * @param[in] crate Crate context
+ * @return The selected register access backend
+ */
+const vldBackend *
+vldCrateGetBackend(vldCrate *crate)
+{
+  return crate->vldBE;
+}
+
+/**
+ * @brief vldCrateGetBackend, for the default crate
+ */
+const vldBackend *
+vldGetBackend()
+{
+  return vldCrateGetBackend(&vldDefaultCrate);
+}
+
+/** \cond PRIVATE */
+/* Preallocated arena, from vldSetArena.  Guarded by vldArenaMutex */
+static pthread_mutex_t vldArenaMutex = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t *vldArenaBase = NULL;
+static size_t vldArenaSize = 0;
+static size_t vldArenaUsed = 0;
+
+static void vldPoolPrestart();
+static void vldPoolLanes(int32_t nlanes, vldSlotFunction func, void *arg);
+
+/* Allocate from the arena, aligned to a cache line.  Never freed */
+static void *
+vldArenaAlloc(size_t size)
+{
+  void *ptr = NULL;
+  size_t start;
+
+  pthread_mutex_lock(&vldArenaMutex);
+  start = (vldArenaUsed + VLD_CACHE_LINE - 1) & ~((size_t)VLD_CACHE_LINE - 1);
+  if(start + size <= vldArenaSize)
+    {
+      ptr = vldArenaBase + start;
+      vldArenaUsed = start + size;
+    }
+  pthread_mutex_unlock(&vldArenaMutex);
+
+  return ptr;
+}
+/** \endcond */
+
+/**
+ * @brief Select the allocation-free mode
+ * @details Take the library's memory from a preallocated arena, instead
+ * of malloc.  Crate contexts (vldCrateCreate) are allocated from the
+ * arena, and never returned to it.  The group worker threads are started
+ * now, rather than on the first group operation, and also do the address
+ * probes of vldInit and vldRescan.  The synchronous clock source switches
+ * run in the calling thread.  Once the crates are
+ * initialized, the library does not allocate memory or create threads,
+ * other than vldSetClockSourceAsync and vldSamplerStart.  Call before
+ * vldCrateCreate and vldInit.
+ * @param[in] arena Memory for the library, aligned to 64 bytes.  Its
+ * pages should be touched (or locked) by the caller, for no page faults
+ * @param[in] size Size of the arena, from vldArenaRequired
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldSetArena(void *arena, size_t size)
+{
+  if((arena == NULL) || ((uintptr_t)arena & (VLD_CACHE_LINE - 1)))
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid arena");
+      return ERROR;
+    }
+
+  pthread_mutex_lock(&vldArenaMutex);
+  if(vldArenaBase != NULL)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_BAD_STATE, -1, "Arena already set");
+      pthread_mutex_unlock(&vldArenaMutex);
+      return ERROR;
+    }
+  vldArenaBase = (uint8_t *)arena;
+  vldArenaSize = size;
+  vldArenaUsed = 0;
+  pthread_mutex_unlock(&vldArenaMutex);
+
+  vldPoolPrestart();
+
+  return OK;
+}
+
+/**
+ * @brief Return the arena size needed for a number of crates
+ * @param[in] ncrates Number of crate contexts, from vldCrateCreate
+ * @return Size, in bytes
+ */
+size_t
+vldArenaRequired(uint32_t ncrates)
+{
+  return ncrates * ((sizeof(vldCrate) + VLD_CACHE_LINE - 1) & ~((size_t)VLD_CACHE_LINE - 1));
+}
+
+/**
+ * @brief Return the use of the arena
+ * @param[out] used Bytes allocated from the arena
+ * @param[out] size Size of the arena.  0 if there's no arena
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldGetArenaUsage(size_t *used, size_t *size)
+{
+  if((used == NULL) || (size == NULL))
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid pointer");
+      return ERROR;
+    }
+
+  pthread_mutex_lock(&vldArenaMutex);
+  *used = vldArenaUsed;
+  *size = vldArenaSize;
+  pthread_mutex_unlock(&vldArenaMutex);
+
+  return OK;
+}
+
+/**
+ * @brief Create a crate context
+ * @details Create a context for the modules of a crate, with its own
+ * slot tables and locks.  Each routine has a vldCrate variant that takes
+ * the context as its first argument.  The routines without a crate use
+ * the default crate (vldCrateDefault).
+ * @param[in] backend Register access backend.  NULL for the default backend
+ * @return Crate context if successful, otherwise NULL.
+ */
+vldCrate *
+vldCrateCreate(const vldBackend *backend)
+{
+  vldCrate *crate;
+  int32_t islot;
+
+  /* Aligned, for the per module entries */
+  if(vldArenaBase != NULL)
+    crate = (vldCrate *)vldArenaAlloc(sizeof(vldCrate));
+  else if(posix_memalign((void **)&crate, VLD_CACHE_LINE, sizeof(vldCrate)) != 0)
+    crate = NULL;
+
+  if(crate == NULL)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_SYSTEM, -1, "Unable to allocate crate");
+      return NULL;
+    }
+
+  memset(crate, 0, sizeof(vldCrate));
+  crate->st = &crate->local;
+  pthread_mutex_init(&crate->st->vldMutex, NULL);
+  for(islot = 0; islot <= MAX_VME_SLOTS; islot++)
+    {
+      pthread_rwlock_init(&crate->st->mod[islot].lock.rw, NULL);
+      pthread_mutex_init(&crate->st->mod[islot].lock.mx, NULL);
+    }
+  crate->vldBE = VLD_DEFAULT_BACKEND;
+  pthread_mutex_init(&crate->samplerMutex, NULL);
+  pthread_mutex_init(&crate->deltaMutex, NULL);
+
+  if((backend != NULL) && (vldCrateSetBackend(crate, backend) != OK))
+    {
+      vldCrateDestroy(crate);
+      return NULL;
+    }
+
+  return crate;
+}
+
+/**
+ * @brief Destroy a crate context
+ * @details Stop the crate's sampler, and free the context.  No other
+ * thread may be using the crate.  The default crate can not be destroyed.
+ * @param[in] crate Crate context, from vldCrateCreate
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateDestroy(vldCrate *crate)
+{
+  int32_t islot;
+
+  if((crate == NULL) || (crate == &vldDefaultCrate))
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid crate");
+      return ERROR;
+    }
+
+  vldCrateSamplerStop(crate);
+
+  for(islot = 0; islot <= MAX_VME_SLOTS; islot++)
+    {
+      pthread_rwlock_destroy(&crate->local.mod[islot].lock.rw);
+      pthread_mutex_destroy(&crate->local.mod[islot].lock.mx);
+    }
+  pthread_mutex_destroy(&crate->local.vldMutex);
+  pthread_mutex_destroy(&crate->samplerMutex);
+  pthread_mutex_destroy(&crate->deltaMutex);
+  if(crate->shm)
+    munmap(crate->shm, sizeof(vldShared));
+
+  /* Memory from the arena is not returned */
+  if(((uint8_t *)crate < vldArenaBase) || ((uint8_t *)crate >= vldArenaBase + vldArenaSize))
+    free(crate);
+
+  return OK;
+}
+
+/**
+ * @brief Return the default crate
+ * @return Crate context used by the routines without a crate
+ */
+vldCrate *
+vldCrateDefault()
+{
+  return &vldDefaultCrate;
+}
+
+/**
+ * @brief Set the address list of a crate
+ * @details Set the A24 addresses (or slot numbers) checked by
+ * vldCrateInit with VLD_INIT_USE_ADDR_LIST.  vldInit uses vldAddrList.
+ * @param[in] crate Crate context
+ * @param[in] addrList A24 addresses, or slot numbers
+ * @param[in] naddr Number of addresses in addrList
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateSetAddrList(vldCrate *crate, const uint32_t *addrList, uint32_t naddr)
+{
+  if((addrList == NULL) || (naddr > MAX_VME_SLOTS + 1))
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid address list");
+      return ERROR;
+    }
+
+  VLOCK;
+  memset(crate->vldAddrList, 0, sizeof(crate->vldAddrList));
+  memcpy(crate->vldAddrList, addrList, naddr * sizeof(uint32_t));
+  VUNLOCK;
+
+  return OK;
+}
+
+/**
+ * @brief Share a crate between processes
+ * @details Keep the slot tables, register shadows, and locks of the crate
+ * in the named shared memory segment, created by the first process to
+ * attach to it.  The locks are robust: if a process dies holding one, the
+ * next process to take it repairs the slot tables, or invalidates the
+ * shadow of the module.  The modules initialized (or rescanned) by one
+ * process are mapped by the others on their next call.  Call before
+ * vldCrateInit, with no other thread using the crate.
+ * @param[in] crate Crate context
+ * @param[in] name Name of the shared memory segment, e.g. "/vld"
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateAttachShared(vldCrate *crate, const char *name)
+{
+  pthread_mutexattr_t attr;
+  vldShared *shm;
+  struct stat sb;
+  int32_t islot, itry, creator = 1;
+  int fd;
+
+  if(name == NULL)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid name");
+      return ERROR;
+    }
+
+  VLOCK;
+  if((crate->shm != NULL) || (crate->st->nVLD > 0))
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_BAD_STATE, -1,
+	     "Crate must be shared before vldInit");
+      VUNLOCK;
+      return ERROR;
+    }
+
+  fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0666);
+  if((fd < 0) && (errno == EEXIST))
+    {
+      creator = 0;
+      fd = shm_open(name, O_RDWR, 0);
+    }
+  if(fd < 0)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_SYSTEM, -1, "shm_open(%s) failed: %s",
+	     name, strerror(errno));
+      VUNLOCK;
+      return ERROR;
+    }
+
+  if(creator)
+    {
+      if(ftruncate(fd, sizeof(vldShared)) != 0)
+	{
+	  vldLog(VLD_LOG_ERROR, VLD_ERR_SYSTEM, -1, "ftruncate(%s) failed: %s",
+		 name, strerror(errno));
+	  close(fd);
+	  shm_unlink(name);
+	  VUNLOCK;
+	  return ERROR;
+	}
+    }
+  else
+    {
+      /* Wait for the creator to size it */
+      for(itry = 0; itry < 1000; itry++)
+	{
+	  if((fstat(fd, &sb) == 0) && (sb.st_size >= (off_t)sizeof(vldShared)))
+	    break;
+	  usleep(1000);
+	}
+      if(itry == 1000)
+	{
+	  vldLog(VLD_LOG_ERROR, VLD_ERR_SYSTEM, -1, "%s is not a VLD crate", name);
+	  close(fd);
+	  VUNLOCK;
+	  return ERROR;
+	}
+    }
+
+  shm = (vldShared *)mmap(NULL, sizeof(vldShared), PROT_READ | PROT_WRITE,
+			  MAP_SHARED, fd, 0);
+  close(fd);
+  if(shm == MAP_FAILED)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_SYSTEM, -1, "mmap(%s) failed: %s",
+	     name, strerror(errno));
+      VUNLOCK;
+      return ERROR;
+    }
+
+  if(creator)
+    {
+      pthread_mutexattr_init(&attr);
+      pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+      pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+      pthread_mutex_init(&shm->state.vldMutex, &attr);
+      for(islot = 0; islot <= MAX_VME_SLOTS; islot++)
+	pthread_mutex_init(&shm->state.mod[islot].lock.mx, &attr);
+      pthread_mutexattr_destroy(&attr);
+
+      shm->magic = VLD_SHARED_MAGIC;
+      shm->size = sizeof(vldShared);
+      __atomic_store_n(&shm->ready, 1, __ATOMIC_RELEASE);
+    }
+  else
+    {
+      /* Wait for the creator to initialize it */
+      for(itry = 0; itry < 1000; itry++)
+	{
+	  if(__atomic_load_n(&shm->ready, __ATOMIC_ACQUIRE))
+	    break;
+	  usleep(1000);
+	}
+      if((itry == 1000) || (shm->magic != VLD_SHARED_MAGIC) ||
+	 (shm->size != sizeof(vldShared)))
+	{
+	  vldLog(VLD_LOG_ERROR, VLD_ERR_SYSTEM, -1,
+		 "%s is not a VLD crate of this library version", name);
+	  munmap(shm, sizeof(vldShared));
+	  VUNLOCK;
+	  return ERROR;
+	}
+    }
+
+  crate->shm = shm;
+  crate->st = &shm->state;
+  crate->mapSeq = 0;
+  pthread_mutex_unlock(&crate->local.vldMutex);
+
+  vldLog(VLD_LOG_INFO, VLD_ERR_NONE, -1, "%s crate %s",
+	 creator ? "Created" : "Attached to", name);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateAttachShared, for the default crate
+ */
+int32_t
+vldAttachShared(const char *name)
+{
+  return vldCrateAttachShared(&vldDefaultCrate, name);
+}
+
+/**
+ * @brief Remove a shared crate
+ * @details Remove the name of the shared memory segment.  Processes
+ * attached to it keep using it, and the next process to attach creates a
+ * new one.
+ * @param[in] name Name of the shared memory segment
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldUnlinkShared(const char *name)
+{
+  if((name == NULL) || (shm_unlink(name) != 0))
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_SYSTEM, -1, "shm_unlink(%s) failed", name ? name : "");
+      return ERROR;
+    }
+
+  return OK;
+}
+
+/** \cond PRIVATE */
+/* Probe of a candidate address, in vldInit */
+typedef struct
+{
+  uintptr_t laddr;
+  int32_t res;             /* < 0 if nothing responded */
+  uint32_t rdata;          /* boardID */
+  uint32_t firmware;       /* if it's a VLD with a valid slot number */
+} vldProbe;
+
+typedef struct
+{
+  vldCrate *crate;
+  vldProbe *probe;
+  int32_t nprobe;
+  int32_t next;            /* next probe to start */
+  int32_t nread;           /* firmware reads */
+} vldProbeSet;
+
+/* Geographic address of a VLD, for the order of the slot tables.  0 for anything else */
+#define VLD_PROBE_GEO(_p)						\
+  (((_p).res >= 0) && vldBoardIsVLD((_p).rdata) ?			\
+   vldDecode_boardID_GEOADR((_p).rdata) : 0)
+
+static int32_t
+vldProbeWorker(int32_t lane, void *arg)
+{
+  vldProbeSet *set = (vldProbeSet *)arg;
+  vldCrate *crate = set->crate;
+  vldProbe *p;
+  int32_t index;
+  uint32_t geo;
+
+  while((index = __atomic_fetch_add(&set->next, 1, __ATOMIC_RELAXED)) < set->nprobe)
+    {
+      p = &set->probe[index];
+      p->firmware = 0;
+      p->res = crate->vldBE->memProbe(&((vldRegs *)p->laddr)->boardID, &p->rdata);
+
+      geo = VLD_PROBE_GEO(*p);
+      if((geo > 0) && (geo <= 21))
+	{
+	  p->firmware = crate->vldBE->read32((volatile uint32_t *)(p->laddr + 0x7c))
+	    & VLD_FIRMWARE_ID_MASK;
+	  __atomic_fetch_add(&set->nread, 1, __ATOMIC_RELAXED);
+	}
+    }
+
+  return OK;
+}
+
+/* Probe each address, with as many at once as the backend allows, on the
+   group worker pool.  Returns the number of firmware reads */
+static int32_t
+vldProbeAll(vldCrate *crate, vldProbe *probe, int32_t nprobe)
+{
+  vldProbeSet set = { crate, probe, nprobe, 0, 0 };
+  int32_t nlanes = crate->vldBE->maxProbes;
+
+  if(nlanes > nprobe)
+    nlanes = nprobe;
+  if(nlanes < 1)
+    nlanes = 1;
+
+  vldPoolLanes(nlanes, vldProbeWorker, &set);
+
+  return set.nread;
+}
+
+/* Discovery cache, of the VLDs found by vldInit in each crate */
+#define VLD_DISCOVERY_MAGIC  "vldDiscoveryCache 1"
+
+typedef struct
+{
+  uint32_t crateID;
+  int32_t ncand;
+  uint32_t cand[MAX_VME_SLOTS+1];      /* A24 addresses checked */
+  int32_t nboard;
+  uint32_t addr[MAX_VME_SLOTS+1];      /* A24 address of each VLD found */
+  uint32_t boardID[MAX_VME_SLOTS+1];
+  uint32_t firmware[MAX_VME_SLOTS+1];
+} vldDiscoveryCrate;
+
+/* Room is left for the temporary file's .pid suffix.  Empty to not use a cache */
+#define VLD_DISCOVERY_PATH_MAX  (PATH_MAX - 16)
+static char vldDiscoveryPath[VLD_DISCOVERY_PATH_MAX];
+static pthread_mutex_t vldDiscoveryMutex = PTHREAD_MUTEX_INITIALIZER;  /* guards the path, and the file */
+
+/* Read the crates from the cache file.  Returns the number read, 0 if
+   there is no file or it is not valid */
+static int32_t
+vldDiscoveryRead(vldDiscoveryCrate *cached)
+{
+  FILE *f;
+  char line[512], *pos, *end;
+  vldDiscoveryCrate *c = NULL;
+  int32_t ncrates = 0, icand;
+  uint32_t addr, boardID, firmware;
+
+  f = fopen(vldDiscoveryPath, "r");
+  if(f == NULL)
+    return 0;
+
+  if((fgets(line, sizeof(line), f) == NULL) ||
+     (strncmp(line, VLD_DISCOVERY_MAGIC, strlen(VLD_DISCOVERY_MAGIC)) != 0))
+    goto invalid;
+
+  while(fgets(line, sizeof(line), f) != NULL)
+    {
+      if(strncmp(line, "crate ", 6) == 0)
+	{
+	  if(ncrates == VLD_DISCOVERY_MAX_CRATES)
+	    goto invalid;
+	  c = &cached[ncrates++];
+	  memset(c, 0, sizeof(*c));
+
+	  pos = line + 6;
+	  c->crateID = strtoul(pos, &end, 0);
+	  pos = end;
+	  c->ncand = strtol(pos, &end, 0);
+	  if((end == pos) || (c->ncand <= 0) || (c->ncand > MAX_VME_SLOTS + 1))
+	    goto invalid;
+	  for(icand = 0; icand < c->ncand; icand++)
+	    {
+	      pos = end;
+	      c->cand[icand] = strtoul(pos, &end, 0);
+	      if(end == pos)
+		goto invalid;
+	    }
+	}
+      else if(sscanf(line, "board %x %x %x", &addr, &boardID, &firmware) == 3)
+	{
+	  if((c == NULL) || (c->nboard == MAX_VME_SLOTS + 1))
+	    goto invalid;
+	  c->addr[c->nboard] = addr;
+	  c->boardID[c->nboard] = boardID;
+	  c->firmware[c->nboard] = firmware;
+	  c->nboard++;
+	}
+      else
+	goto invalid;
+    }
+
+  fclose(f);
+  return ncrates;
+
+ invalid:
+  vldLog(VLD_LOG_WARN, VLD_ERR_NO_DATA, -1,
+	 "Ignoring invalid discovery cache %s", vldDiscoveryPath);
+  fclose(f);
+  return 0;
+}
+
+/* Whether the crate was cached from the same list of addresses */
+static int32_t
+vldDiscoveryMatch(vldCrate *crate, const vldDiscoveryCrate *c, const vldProbe *probe, int32_t nprobe)
+{
+  int32_t iprobe;
+
+  if((c->ncand != nprobe) || (c->nboard == 0))
+    return 0;
+
+  for(iprobe = 0; iprobe < nprobe; iprobe++)
+    {
+      if(c->cand[iprobe] != (uint32_t)(probe[iprobe].laddr - crate->vldA24Offset))
+	return 0;
+    }
+
+  return 1;
+}
+
+/* Fill in the probes from the discovery cache.  Each cached VLD is
+   confirmed with a single boardID read, and empty addresses are not probed.
+   Returns the number of boardID reads, or ERROR if the cache does not match */
+static int32_t
+vldDiscoveryLoad(vldCrate *crate, vldProbe *probe, int32_t nprobe)
+{
+  vldDiscoveryCrate cached[VLD_DISCOVERY_MAX_CRATES], *c = NULL;
+  int32_t ncrates, icrate, iprobe, iboard, nread = 0;
+  uint32_t firstAddr = 0, firstID = 0, rdata;
+
+  ncrates = vldDiscoveryRead(cached);
+
+  /* The crate ID, from the first cached board with these addresses */
+  for(icrate = 0; icrate < ncrates; icrate++)
+    {
+      if(!vldDiscoveryMatch(crate, &cached[icrate], probe, nprobe))
+	continue;
+
+      if(nread == 0)
+	{
+	  firstAddr = cached[icrate].addr[0];
+	  nread++;
+	  if(crate->vldBE->memProbe(&((vldRegs *)(firstAddr + crate->vldA24Offset))->boardID,
+			     &firstID) < 0)
+	    break;
+	}
+
+      if(cached[icrate].crateID == (firstID & VLD_BOARDID_CRATEID_MASK))
+	{
+	  c = &cached[icrate];
+	  break;
+	}
+    }
+
+  if(c == NULL)
+    {
+      if(nread > 0)
+	vldLog(VLD_LOG_WARN, VLD_ERR_NO_MODULE, -1,
+	       "Crate at VME addr=0x%x not in discovery cache, scanning",
+	       firstAddr);
+      return ERROR;
+    }
+
+  for(iprobe = 0; iprobe < nprobe; iprobe++)
+    {
+      probe[iprobe].res = -1;
+      probe[iprobe].rdata = 0;
+      probe[iprobe].firmware = 0;
+    }
+
+  for(iboard = 0; iboard < c->nboard; iboard++)
+    {
+      for(iprobe = 0; iprobe < nprobe; iprobe++)
+	{
+	  if(c->cand[iprobe] == c->addr[iboard])
+	    break;
+	}
+      if(iprobe == nprobe)
+	return ERROR;
+
+      if(c->addr[iboard] == firstAddr)
+	rdata = firstID;
+      else
+	{
+	  nread++;
+	  if(crate->vldBE->memProbe(&((vldRegs *)probe[iprobe].laddr)->boardID, &rdata) < 0)
+	    rdata = 0;
+	}
+
+      if(rdata != c->boardID[iboard])
+	{
+	  vldLog(VLD_LOG_WARN, VLD_ERR_NO_MODULE, -1,
+		 "Board at VME addr=0x%x does not match discovery cache "
+		 "(0x%08x != 0x%08x), scanning",
+		 c->addr[iboard], rdata, c->boardID[iboard]);
+	  return ERROR;
+	}
+
+      probe[iprobe].res = 0;
+      probe[iprobe].rdata = rdata;
+      probe[iprobe].firmware = c->firmware[iboard];
+    }
+
+  vldLog(VLD_LOG_INFO, VLD_ERR_NONE, -1,
+	 "Using discovery cache for crate %d (%d VLDs)", c->crateID, c->nboard);
+
+  return nread;
+}
+
+/* Record the VLDs found in this crate, keeping the other crates in the file */
+static void
+vldDiscoverySave(vldCrate *crate, const vldProbe *probe, int32_t nprobe, const int32_t *found, int32_t nfound)
+{
+  vldDiscoveryCrate cached[VLD_DISCOVERY_MAX_CRATES], *c;
+  int32_t ncrates, icrate, iprobe, iboard;
+  char tmppath[PATH_MAX];
+  FILE *f;
+
+  ncrates = vldDiscoveryRead(cached);
+
+  /* Replace this crate, or make room for it */
+  for(icrate = 0; icrate < ncrates; icrate++)
+    {
+      if((cached[icrate].crateID == (probe[found[0]].rdata & VLD_BOARDID_CRATEID_MASK)) &&
+	 vldDiscoveryMatch(crate, &cached[icrate], probe, nprobe))
+	break;
+    }
+  if(icrate == VLD_DISCOVERY_MAX_CRATES)
+    icrate = 0;   /* the first is the oldest */
+  if(icrate < ncrates)
+    {
+      memmove(&cached[icrate], &cached[icrate+1], (ncrates - icrate - 1) * sizeof(*c));
+      ncrates--;
+    }
+
+  c = &cached[ncrates++];
+  memset(c, 0, sizeof(*c));
+  c->crateID = probe[found[0]].rdata & VLD_BOARDID_CRATEID_MASK;
+  c->ncand = nprobe;
+  for(iprobe = 0; iprobe < nprobe; iprobe++)
+    c->cand[iprobe] = probe[iprobe].laddr - crate->vldA24Offset;
+  for(iboard = 0; iboard < nfound; iboard++)
+    {
+      c->addr[iboard] = probe[found[iboard]].laddr - crate->vldA24Offset;
+      c->boardID[iboard] = probe[found[iboard]].rdata;
+      c->firmware[iboard] = probe[found[iboard]].firmware;
+    }
+  c->nboard = nfound;
+
+  /* Replace the file, so that a reader never sees part of it */
+  snprintf(tmppath, sizeof(tmppath), "%s.%d", vldDiscoveryPath, (int)getpid());
+  f = fopen(tmppath, "w");
+  if(f == NULL)
+    {
+      vldLog(VLD_LOG_WARN, VLD_ERR_SYSTEM, -1,
+	     "Unable to write discovery cache %s: %s", tmppath, strerror(errno));
+      return;
+    }
+
+  fprintf(f, "%s\n", VLD_DISCOVERY_MAGIC);
+  for(icrate = 0; icrate < ncrates; icrate++)
+    {
+      c = &cached[icrate];
+      fprintf(f, "crate 0x%02x %d", c->crateID, c->ncand);
+      for(iprobe = 0; iprobe < c->ncand; iprobe++)
+	fprintf(f, " 0x%06x", c->cand[iprobe]);
+      fprintf(f, "\n");
+      for(iboard = 0; iboard < c->nboard; iboard++)
+	fprintf(f, "board 0x%06x 0x%08x 0x%02x\n",
+		c->addr[iboard], c->boardID[iboard], c->firmware[iboard]);
+    }
+
+  if((fclose(f) != 0) || (rename(tmppath, vldDiscoveryPath) != 0))
+    {
+      vldLog(VLD_LOG_WARN, VLD_ERR_SYSTEM, -1,
+	     "Unable to write discovery cache %s: %s", vldDiscoveryPath, strerror(errno));
+      unlink(tmppath);
+    }
+}
+/** \endcond */
+
+/**
+ * @brief Select the discovery cache file
+ * @details When selected, vldInit records the VLDs that it finds, by
+ * crate ID, in this file.  On the next vldInit with the same addresses,
+ * each cached VLD is confirmed with a single boardID read and the empty
+ * addresses are not probed.  Any mismatch falls back to a full scan,
+ * which rewrites the cache.  Must be called before vldInit.
+ * @param[in] path Cache file path, shorter than PATH_MAX - 16.  NULL to not use a cache (default)
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldSetDiscoveryCache(const char *path)
+{
+  if((path != NULL) && (strlen(path) >= VLD_DISCOVERY_PATH_MAX))
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Path too long.  Max = %d",
+	     VLD_DISCOVERY_PATH_MAX - 1);
+      return ERROR;
+    }
+
+  pthread_mutex_lock(&vldDiscoveryMutex);
+  if(path != NULL)
+    strcpy(vldDiscoveryPath, path);
+  else
+    vldDiscoveryPath[0] = '\0';
+  pthread_mutex_unlock(&vldDiscoveryMutex);
+
+  return OK;
+}
+
+/**
+ * @brief Initialize the VLD Library
+ *
+ * @details Increment through A24 addresses and initialize library
+ * with modules that match the VLD boardID and supported firmware version(s).
+ * Its messages are queued, as all library messages, and written later by
+ * the log drain thread.  A caller that redirects stdout around it calls
+ * vldLogFlush() before restoring stdout.
+ *
+ * @param[in] crate Crate context
+ * @param[in] addr First address to check
+ * @param[in] addr_inc The inc of addr
+ * @param[in] nfind number of addr_inc
+ *
+ * @param[in] iFlag Initialization mask
+ *       bit| desc
+ *       ---|-------------------------
+ *        0 | No module initialization
+ *        1 | Skip the firmware check
+ *        2 | Increment Using the crate's address list (vldCrateSetAddrList)
+ *        4 | Ignore the discovery cache (full scan, cache rewritten)
+ * @return OK if successful, otherwise ERROR
+ */
+int32_t
+vldCrateInit(vldCrate *crate, uint32_t addr, uint32_t addr_inc, uint32_t nfind, uint32_t iFlag)
+{
+  int32_t useList=0, noBoardInit=0;
+  int32_t islot, ivld, iorder, nread;
+  vldProbe probe[MAX_VME_SLOTS+1];
+  int32_t order[MAX_VME_SLOTS+1];
+  int32_t found[MAX_VME_SLOTS+1], nfound = 0, cached = 0;
+  int32_t res;
+  uint32_t rdata, boardID;
+  uintptr_t laddr, laddr_inc;
+  uint32_t firmwareInfo=0, vldVersion=0, vldType=0;
+  volatile vldRegs *vld;
+  VSTATS(vldInit, 0);
+
+  VLOCK;
+
+  /* Check if we're skipping initialization, and just mapping the structure pointer */
+  if(iFlag&VLD_INIT_NO_INIT)
+    {
+      noBoardInit = 1;
+    }
+
+  /* Check if we're initializing using a list */
+  if(iFlag&VLD_INIT_USE_ADDR_LIST)
+    {
+      useList=1;
+    }
+
+  /* Check for valid address */
+  if( (addr==0) && (useList==0) )
+    { /* Scan through valid slot -> A24 address */
+      useList=1;
+      nfind=16;
+
+      /* Loop through JLab VXS Weiner Crate GEOADDR to VME addresses to make a list */
+      for(islot=3; islot<11; islot++) /* First 8 */
+	crate->vldAddrList[islot-3] = (islot<<19);
+
+      /* Skip Switch Slots */
+
+      for(islot=13; islot<21; islot++) /* Last 8 */
+	crate->vldAddrList[islot-5] = (islot<<19);
+
+    }
+  else if(addr > 0x00ffffff)
+    { /* A32 Addressing */
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1,
+	     "A32 Addressing not allowed for VLD configuration space");
+      VUNLOCK;
+      return(ERROR);
+    }
+  else
+    { /* A24 Addressing */
+      if(addr < 22)
+	{ /* First argument is a slot number, instead of VME address */
+	  vldLog(VLD_LOG_INFO, VLD_ERR_NONE, -1,
+		 "Initializing using slot number %d (VME address 0x%x)",
+		 addr, addr<<19);
+	  addr = addr<<19; // Shift to VME A24 address;
+
+	  /* If addr_inc is also in slot number form, shift it */
+	  if((addr_inc<22) && (addr_inc>0))
+	    addr_inc = addr_inc<<19;
+
+	  /* Check and shift the address list, if it's used */
+	  if(useList==1)
+	    {
+	      for(ivld=0; ivld<nfind; ivld++)
+		{
+		  if(crate->vldAddrList[ivld] < 22)
+		    {
+		      crate->vldAddrList[ivld] = crate->vldAddrList[ivld]<<19;
+		    }
+		}
+	    }
+	}
+
+      if( ((addr_inc==0)||(nfind==0)) && (useList==0) )
+	{ /* assume only one VLD to initialize */
+	  nfind = 1;
+	}
+    }
+
+  /* get the VLD address */
+  res = crate->vldBE->busToLocal(addr, &laddr);
+
+#ifndef SHOWERROR
+  crate->vldBE->setQuiet(1);
+#endif
+
+  if (res != 0)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_BUS, -1,
+	     "%s busToLocal(0x39,0x%x,&laddr) failed", crate->vldBE->name, addr);
+      VUNLOCK;
+      return(ERROR);
+    }
+  crate->vldA24Offset = laddr - addr;
+  crate->mapped = 1;
+
+  if(nfind > MAX_VME_SLOTS + 1)
+    {
+      vldLog(VLD_LOG_WARN, VLD_ERR_INVALID_ARG, -1,
+	     "Only checking the first %d addresses", MAX_VME_SLOTS + 1);
+      nfind = MAX_VME_SLOTS + 1;
+    }
+
+  /* Probe all of the addresses, before adding any to the slot tables */
+  for (ivld=0;ivld<nfind;ivld++)
+    {
+      if(useList==1)
+	{
+	  probe[ivld].laddr = crate->vldAddrList[ivld] + crate->vldA24Offset;
+	}
+      else
+	{
+	  probe[ivld].laddr = laddr +ivld*addr_inc;
+	}
+    }
+  /* Remember the addresses, for vldRescan */
+  for (ivld=0;ivld<nfind;ivld++)
+    {
+      for(islot = 0; islot < crate->st->nScanAddr; islot++)
+	{
+	  if(crate->st->vldScanAddr[islot] == (uint32_t)(probe[ivld].laddr - crate->vldA24Offset))
+	    break;
+	}
+      if((islot == crate->st->nScanAddr) && (crate->st->nScanAddr < MAX_VME_SLOTS + 1))
+	crate->st->vldScanAddr[crate->st->nScanAddr++] = probe[ivld].laddr - crate->vldA24Offset;
+    }
+
+  pthread_mutex_lock(&vldDiscoveryMutex);
+  if((vldDiscoveryPath[0] != '\0') && !(iFlag & VLD_INIT_IGNORE_CACHE))
+    {
+      nread = vldDiscoveryLoad(crate, probe, nfind);
+      if(nread != ERROR)
+	{
+	  cached = 1;
+	  VSTATS_ADD(probes, nread);
+	}
+    }
+  pthread_mutex_unlock(&vldDiscoveryMutex);
+
+  if(!cached)
+    {
+      nread = vldProbeAll(crate, probe, nfind);
+      VSTATS_ADD(probes, nfind);
+      VSTATS_ADD(reads, nread);
+    }
+
+  /* Add them in geographic order */
+  for (ivld=0;ivld<nfind;ivld++)
+    {
+      for(iorder = ivld; (iorder > 0) &&
+	    (VLD_PROBE_GEO(probe[order[iorder-1]]) > VLD_PROBE_GEO(probe[ivld])); iorder--)
+	order[iorder] = order[iorder-1];
+      order[iorder] = ivld;
+    }
+
+  for (iorder=0;iorder<nfind;iorder++)
+    {
+      laddr_inc = probe[order[iorder]].laddr;
+      res = probe[order[iorder]].res;
+      rdata = probe[order[iorder]].rdata;
+
+      vld = (vldRegs *)laddr_inc;
+      if(res < 0)
+	{
+#ifdef SHOWERRORS
+#ifdef VXWORKS
+	  vldLog(VLD_LOG_ERROR, VLD_ERR_NO_MODULE, -1,
+		 "No addressable board at addr=0x%x", (UINT32) vld);
+#else
+	  vldLog(VLD_LOG_ERROR, VLD_ERR_NO_MODULE, -1,
+		 "No addressable board at VME (Local) addr=0x%x (0x%x)",
+		 (UINT32) laddr_inc-crate->vldA24Offset, (UINT32) vld);
+#endif
+#endif /* SUPPRESSERRORSES */
+	}
+      else
+	{
+	  /* Check that it is a VLD */
+	  if(!vldBoardIsVLD(rdata))
+	    {
+	      vldLog(VLD_LOG_WARN, VLD_ERR_NO_MODULE, -1,
+		     "For board at VME addr=0x%x, Invalid Board ID: 0x%x",
+		     (UINT32)(laddr_inc - crate->vldA24Offset), rdata);
+	      continue;
+	    }
+	  else
+	    {
+	      /* Check if this is board has a valid slot number */
+	      boardID =  vldDecode_boardID_GEOADR(rdata);
+	      if((boardID <= 0)||(boardID >21))
+		{
+		  vldLog(VLD_LOG_WARN, VLD_ERR_NO_MODULE, -1,
+			 "Board Slot ID is not in range: %d (this module ignored)",
+			 boardID);
+		  continue;
+		}
+	      else
+		{
+		  firmwareInfo = probe[order[iorder]].firmware;
+		  if(firmwareInfo <= 0)
+		    {
+		      vldLog(VLD_LOG_ERROR, VLD_ERR_NO_MODULE, boardID,
+			     "Invalid firmware 0x%08x", firmwareInfo);
+		      VUNLOCK;
+		      return ERROR;
+		    }
+
+		  VSLOCK_WR(boardID);
+		  crate->mod[boardID].VLDp = (vldRegs *)(laddr_inc);
+		  crate->st->mod[boardID].a24 = laddr_inc - crate->vldA24Offset;
+		  crate->st->mod[boardID].shadow.boardID = rdata;
+		  crate->st->mod[boardID].shadowValid = 1ULL;  /* only boardID is known */
+		  crate->mod[boardID].pendingActive = 0;
+		  crate->mod[boardID].pendingDirty = 0;
+		  crate->st->mod[boardID].fwVers = firmwareInfo;
+		  crate->mod[boardID].ops = vldFirmwareSelect(firmwareInfo, rdata);
+		  vldPublishReset(crate, boardID, rdata);
+		  __atomic_add_fetch(&crate->st->mod[boardID].resetSeq, 1, __ATOMIC_RELEASE);
+		  VSUNLOCK(boardID);
+		  vldTableAdd(crate, boardID);
+
+		  vldLog(VLD_LOG_INFO, VLD_ERR_NONE, boardID,
+			 "Initialized VLD %2d  FW 0x%2x Slot #%d at address 0x%08lx (0x%08x)",
+			 nfound, firmwareInfo, boardID,
+			 (unsigned long) crate->mod[boardID].VLDp,
+			 (uint32_t)((unsigned long)crate->mod[boardID].VLDp-crate->vldA24Offset));
+		  found[nfound++] = order[iorder];
+		}
+	    }
+	}
+    }
+
+#ifndef SHOWERROR
+  crate->vldBE->setQuiet(0);
+#endif
+
+  pthread_mutex_lock(&vldDiscoveryMutex);
+  if((vldDiscoveryPath[0] != '\0') && !cached && (nfound > 0))
+    vldDiscoverySave(crate, probe, nfind, found, nfound);
+  pthread_mutex_unlock(&vldDiscoveryMutex);
+
+  if(noBoardInit)
+    {
+      if(crate->st->nVLD>0)
+	{
+	  vldLog(VLD_LOG_INFO, VLD_ERR_NONE, -1,
+		 "%d VLD(s) successfully mapped (not initialized)", crate->st->nVLD);
+	  VUNLOCK;
+	  return OK;
+	}
+    }
+
+  if(crate->st->nVLD==0)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_NO_MODULE, -1,
+	     "Unable to initialize any VLD modules");
+      VUNLOCK;
+      return ERROR;
+    }
+
+  VUNLOCK;
+  return OK;
+
+}
+
+/**
+ * @brief vldCrateInit, for the default crate
+ */
+int32_t
+vldInit(uint32_t addr, uint32_t addr_inc, uint32_t nfind, uint32_t iFlag)
+{
+  /* The address list of the default crate is the user initialized vldAddrList */
+  if(iFlag & VLD_INIT_USE_ADDR_LIST)
+    vldCrateSetAddrList(&vldDefaultCrate, vldAddrList, MAX_VME_SLOTS + 1);
+
+  return vldCrateInit(&vldDefaultCrate, addr, addr_inc, nfind, iFlag);
+}
+
+/**
+ * @brief Return the slot ID
+ * @details Given the order of initialization, return the slot ID of the provided index
+ * @param[in] crate Crate context
+ * @param[in] index
+ * @return slot ID if successful, otherwise ERROR
+ */
+int32_t
+vldCrateSlot(vldCrate *crate, uint32_t index)
+{
+  int32_t slots[MAX_VME_SLOTS+1], nslots;
+
+  nslots = vldTableCopy(crate, slots);
+  if(index >= nslots)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid index (%d)", index);
+      return ERROR;
+    }
+  return slots[index];
+}
+
+/**
+ * @brief vldCrateSlot, for the default crate
+ */
+int32_t
+vldSlot(uint32_t index)
+{
+  return vldCrateSlot(&vldDefaultCrate, index);
+}
+
+/**
+ * @brief Return a mask of initialized VLD slotIDs
+ * @param[in] crate Crate context
+ * @return a mask of initialized VLD slotIDs
+ */
+uint32_t
+vldCrateSlotMask(vldCrate *crate)
+{
+  VSYNC;
+  return __atomic_load_n(&crate->st->vldSlotPresent, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief vldCrateSlotMask, for the default crate
+ */
+uint32_t
+vldSlotMask()
+{
+  return vldCrateSlotMask(&vldDefaultCrate);
+}
+
+/**
+ * @brief Rescan the crate for added, removed, or replaced modules
+ * @details Checks the addresses of the previous vldInit calls.  Each
+ * module in the slot tables is verified with a single boardID read, and
+ * only the other addresses are probed.  A module that no longer responds,
+ * or has a different boardID, is removed (or replaced, if a VLD is found
+ * at that address).  The slot tables are updated at once, in geographic
+ * order, so other threads never see part of the change.
+ *
+ *       bit| desc
+ *       ---|-------------------------
+ *        0 | Do not verify the modules in the slot tables
+ *        1 | Do not probe the other addresses
+ *
+ * @param[in] crate Crate context
+ * @param[in] flags Rescan flags
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateRescan(vldCrate *crate, uint32_t flags)
+{
+  vldProbe probe[MAX_VME_SLOTS+1];
+  int32_t slots[MAX_VME_SLOTS+1], nslots = 0;
+  int32_t iaddr, iprobe, nprobe = 0, islot;
+#ifdef VLD_STATS
+  int32_t nread;
+#endif
+  uint32_t oldMask, newMask, changedMask = 0, geo, rdata;
+  VSTATS(vldRescan, 0);
+
+  VLOCK;
+  VSYNC;
+  if(crate->st->nScanAddr == 0)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_BAD_STATE, -1, "vldInit has not been called");
+      VUNLOCK;
+      return ERROR;
+    }
+
+#ifndef SHOWERROR
+  crate->vldBE->setQuiet(1);
+#endif
+
+  oldMask = newMask = crate->st->vldSlotPresent;
+  for(iaddr = 0; iaddr < crate->st->nScanAddr; iaddr++)
+    {
+      /* Module in the slot tables at this address */
+      for(islot = 1; islot <= MAX_VME_SLOTS; islot++)
+	{
+	  if((oldMask & (1 << islot)) &&
+	     (crate->st->mod[islot].a24 == crate->st->vldScanAddr[iaddr]))
+	    break;
+	}
+
+      if(islot <= MAX_VME_SLOTS)
+	{
+	  if(flags & VLD_RESCAN_NO_VERIFY)
+	    continue;
+
+	  VSTATS_COUNT(probes);
+	  if((crate->vldBE->memProbe(&crate->mod[islot].VLDp->boardID, &rdata) >= 0) &&
+	     (rdata == crate->st->mod[islot].shadow.boardID))
+	    continue;
+
+	  vldLog(VLD_LOG_WARN, VLD_ERR_NO_MODULE, islot, "Module removed or replaced");
+	  newMask &= ~(1 << islot);
+	  changedMask |= (1 << islot);
+	}
+      else if(flags & VLD_RESCAN_NO_PROBE)
+	continue;
+
+      probe[nprobe++].laddr = crate->st->vldScanAddr[iaddr] + crate->vldA24Offset;
+    }
+
+#ifdef VLD_STATS
+  nread = vldProbeAll(crate, probe, nprobe);
+  VSTATS_ADD(probes, nprobe);
+  VSTATS_ADD(reads, nread);
+#else
+  vldProbeAll(crate, probe, nprobe);
+#endif
+
+#ifndef SHOWERROR
+  crate->vldBE->setQuiet(0);
+#endif
+
+  for(iprobe = 0; iprobe < nprobe; iprobe++)
+    {
+      geo = VLD_PROBE_GEO(probe[iprobe]);
+      if((geo == 0) || (geo > 21) || (newMask & (1 << geo)))
+	continue;
+
+      if(probe[iprobe].firmware <= 0)
+	{
+	  vldLog(VLD_LOG_ERROR, VLD_ERR_NO_MODULE, geo,
+		 "Invalid firmware 0x%08x (this module ignored)", probe[iprobe].firmware);
+	  continue;
+	}
+
+      VSLOCK_WR(geo);
+      crate->mod[geo].VLDp = (vldRegs *)probe[iprobe].laddr;
+      crate->st->mod[geo].a24 = probe[iprobe].laddr - crate->vldA24Offset;
+      crate->st->mod[geo].shadow.boardID = probe[iprobe].rdata;
+      crate->st->mod[geo].shadowValid = 1ULL;  /* only boardID is known */
+      /* A transaction open on the old module is dropped.  The sampler sees resetSeq */
+      crate->mod[geo].pendingActive = 0;
+      crate->mod[geo].pendingDirty = 0;
+      crate->st->mod[geo].fwVers = probe[iprobe].firmware;
+      crate->mod[geo].ops = vldFirmwareSelect(probe[iprobe].firmware, probe[iprobe].rdata);
+      vldPublishReset(crate, geo, probe[iprobe].rdata);
+      __atomic_add_fetch(&crate->st->mod[geo].resetSeq, 1, __ATOMIC_RELEASE);
+      VSUNLOCK(geo);
+
+      vldLog(VLD_LOG_INFO, VLD_ERR_NONE, geo,
+	     "Found VLD FW 0x%2x Slot #%d at address 0x%08lx (0x%08x)",
+	     probe[iprobe].firmware, geo, (unsigned long)probe[iprobe].laddr,
+	     (uint32_t)(probe[iprobe].laddr - crate->vldA24Offset));
+      newMask |= (1 << geo);
+      changedMask |= (1 << geo);
+    }
+
+  /* Removed modules keep their (still mapped) VLDp, for threads that passed CHECKID */
+  if(changedMask)
+    {
+      VLD_FOREACH_SLOT(islot, newMask)
+	slots[nslots++] = islot;
+      vldTablePublish(crate, slots, nslots);
+    }
+
+  VUNLOCK;
+  return OK;
+}
+
+/**
+ * @brief vldCrateRescan, for the default crate
+ */
+int32_t
+vldRescan(uint32_t flags)
+{
+  return vldCrateRescan(&vldDefaultCrate, flags);
+}
+
+/**
+ * @brief Return the geographic address
+ * @details Return the geographic address of the specified module
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @return Geographic address, if successful.  Otherwise ERROR.
+ */
+int32_t
+vldCrateGetGeoAddress(vldCrate *crate, int id)
+{
+  int32_t rval = 0;
+  VSTATS(vldGetGeoAddress, id);
+  CHECKID(id);
+
+  VSLOCK_RD(id);
+  rval = vldDecode_boardID_GEOADR(vldCacheRead(crate, id, &crate->mod[id].VLDp->boardID));
+  VSUNLOCK(id);
+
+  return rval;
+}
+
+/**
+ * @brief vldCrateGetGeoAddress, for the default crate
+ */
+int32_t
+vldGetGeoAddress(int id)
+{
+  return vldCrateGetGeoAddress(&vldDefaultCrate, id);
+}
+
+/**
+ * @brief Return the firmware version
+ * @details Return the firmware version of the specified module, read by vldInit
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @return Firmware version, if successful.  Otherwise ERROR.
+ */
+int32_t
+vldCrateGetFirmwareVersion(vldCrate *crate, int32_t id)
+{
+  CHECKID(id);
+
+  return crate->st->mod[id].fwVers;
+}
+
+/**
+ * @brief vldCrateGetFirmwareVersion, for the default crate
+ */
+int32_t
+vldGetFirmwareVersion(int32_t id)
+{
+  return vldCrateGetFirmwareVersion(&vldDefaultCrate, id);
+}
+
+/**
+ * @brief Return the A24 address
+ * @details Return the VME A24 address of the specified module, as found by vldInit
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @return A24 address, if successful.  Otherwise ERROR.
+ */
+int32_t
+vldCrateGetA24Address(vldCrate *crate, int32_t id)
+{
+  CHECKID(id);
+
+  return crate->st->mod[id].a24;
+}
+
+/**
+ * @brief vldCrateGetA24Address, for the default crate
+ */
+int32_t
+vldGetA24Address(int32_t id)
+{
+  return vldCrateGetA24Address(&vldDefaultCrate, id);
+}
+
+/**
+ * @brief Invalidate the register cache
+ * @details Mark the shadow of the configuration registers of the
+ * specified module as stale.  Subsequent getters will re-read the
+ * module, and refill the shadow.
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateCacheInvalidate(vldCrate *crate, int32_t id)
+{
+  VSTATS(vldCacheInvalidate, id);
+  CHECKID(id);
+
+  VSLOCK_WR(id);
+  __atomic_store_n(&crate->st->mod[id].shadowValid, 0, __ATOMIC_RELEASE);
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateCacheInvalidate, for the default crate
+ */
+int32_t
+vldCacheInvalidate(int32_t id)
+{
+  return vldCrateCacheInvalidate(&vldDefaultCrate, id);
+}
+
+/**
+ * @brief Refresh the register cache
+ * @details Re-read all of the cached configuration registers of the
+ * specified module into its shadow.
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateCacheRefresh(vldCrate *crate, int32_t id)
+{
+  uint32_t ireg, iword;
+  uint64_t valid = 0;
+  VSTATS(vldCacheRefresh, id);
+  CHECKID(id);
+
+  VSLOCK_WR(id);
+  for(ireg = 0; ireg < VLD_SHADOW_NREG; ireg++)
+    {
+      iword = vldShadowReg[ireg].offset >> 2;
+      VLD_SHADOW_WORD(id, iword) = vldRead32(&((volatile uint32_t *)crate->mod[id].VLDp)[iword]);
+      valid |= 1ULL << iword;
+    }
+  __atomic_store_n(&crate->st->mod[id].shadowValid, valid, __ATOMIC_RELEASE);
+  vldPublish(crate, id, 0, (const uint32_t *)&crate->st->mod[id].shadow, sizeof(vldRegs) >> 2, valid);
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateCacheRefresh, for the default crate
+ */
+int32_t
+vldCacheRefresh(int32_t id)
+{
+  return vldCrateCacheRefresh(&vldDefaultCrate, id);
+}
+
+/**
+ * @brief Begin a configuration transaction
+ * @details Open a configuration transaction for the specified module.
+ * Until vldConfigCommit (or vldConfigAbort), setters of the
+ * configuration registers stage their values in a pending register
+ * image, instead of writing them to the module.  Getters return the
+ * staged values.  vldSetClockSource, pulse loading and resets are not
+ * staged, and go to the module immediately.
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateConfigBegin(vldCrate *crate, int32_t id)
+{
+  int32_t rval = OK;
+  VSTATS(vldConfigBegin, id);
+  CHECKID(id);
+
+  VSLOCK_WR(id);
+  if(crate->mod[id].pendingActive)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_BAD_STATE, id,
+	     "Configuration transaction already open");
+      rval = ERROR;
+    }
+  else
+    {
+      crate->mod[id].pendingDirty = 0;
+      crate->mod[id].pendingActive = 1;
+    }
+  VSUNLOCK(id);
+
+  return rval;
+}
+
+/**
+ * @brief vldCrateConfigBegin, for the default crate
+ */
+int32_t
+vldConfigBegin(int32_t id)
+{
+  return vldCrateConfigBegin(&vldDefaultCrate, id);
+}
+
+/**
+ * @brief Commit a configuration transaction
+ * @details Validate the staged register image of the specified module,
+ * then write it to the module under a single lock hold.  Registers that
+ * already hold the staged value are not written.  The bleach timer is
+ * only cleared before it is enabled, when needed to generate a rising
+ * edge.  The trigger source mask is written last.  If any staged register
+ * is invalid, nothing is written.  In either case, the transaction is closed.
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateConfigCommit(vldCrate *crate, int32_t id)
+{
+  int32_t rval = OK;
+  uint32_t ireg, iword, wval, bleachWord;
+  uint64_t dirty, valid, bit;
+  volatile uint32_t *regs;
+  VSTATS(vldConfigCommit, id);
+  CHECKID(id);
+
+  regs = (volatile uint32_t *)crate->mod[id].VLDp;
+  bleachWord = ((uintptr_t)&crate->mod[id].VLDp->bleachTime - (uintptr_t)crate->mod[id].VLDp) >> 2;
+
+  VSLOCK_WR(id);
+  if(crate->mod[id].pendingActive == 0)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_BAD_STATE, id, "No configuration transaction open");
+      VSUNLOCK(id);
+      return ERROR;
+    }
+
+  dirty = crate->mod[id].pendingDirty;
+  crate->mod[id].pendingActive = 0;
+  crate->mod[id].pendingDirty = 0;
+
+  /* Validate the whole image, before anything is written */
+  for(ireg = 0; ireg < VLD_SHADOW_NREG; ireg++)
+    {
+      iword = vldShadowReg[ireg].offset >> 2;
+      if((dirty & (1ULL << iword)) &&
+	 (VLD_PENDING_WORD(id, iword) & ~vldShadowReg[ireg].mask))
+	{
+	  vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, id,
+		 "Invalid value (0x%08x) staged for register 0x%02x",
+		 VLD_PENDING_WORD(id, iword), vldShadowReg[ireg].offset);
+	  rval = ERROR;
+	}
+    }
+
+  if(rval == ERROR)
+    {
+      VSUNLOCK(id);
+      return ERROR;
+    }
+
+  valid = __atomic_load_n(&crate->st->mod[id].shadowValid, __ATOMIC_ACQUIRE);
+  for(ireg = 0; ireg < VLD_SHADOW_NREG; ireg++)
+    {
+      iword = vldShadowReg[ireg].offset >> 2;
+      bit = 1ULL << iword;
+      if((dirty & bit) == 0)
+	continue;
+
+      wval = VLD_PENDING_WORD(id, iword);
+
+      if((iword == bleachWord) &&
+	 ((wval & VLD_BLEACHTIME_ENABLE_MASK) == VLD_BLEACHTIME_ENABLE))
+	{
+	  /* Need a rising edge, only if the timer may already be enabled */
+	  if(((valid & bit) == 0) ||
+	     ((VLD_SHADOW_WORD(id, iword) & VLD_BLEACHTIME_ENABLE_MASK) == VLD_BLEACHTIME_ENABLE))
+	    vldCacheWriteNow(crate, id, &regs[iword], 0);
+
+	  vldCacheWriteNow(crate, id, &regs[iword], wval);
+	  continue;
+	}
+
+      /* Skip the write, if the module already has this value */
+      if((valid & bit) && (VLD_SHADOW_WORD(id, iword) == wval))
+	continue;
+
+      vldCacheWriteNow(crate, id, &regs[iword], wval);
+    }
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateConfigCommit, for the default crate
+ */
+int32_t
+vldConfigCommit(int32_t id)
+{
+  return vldCrateConfigCommit(&vldDefaultCrate, id);
+}
+
+/**
+ * @brief Abort a configuration transaction
+ * @details Discard the staged register image of the specified module,
+ * without writing anything to the module.
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateConfigAbort(vldCrate *crate, int32_t id)
+{
+  VSTATS(vldConfigAbort, id);
+  CHECKID(id);
+
+  VSLOCK_WR(id);
+  crate->mod[id].pendingActive = 0;
+  crate->mod[id].pendingDirty = 0;
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateConfigAbort, for the default crate
+ */
+int32_t
+vldConfigAbort(int32_t id)
+{
+  return vldCrateConfigAbort(&vldDefaultCrate, id);
+}
+
+/** \cond PRIVATE */
+/* Words of the register image, 0x000 - 0x104 */
+#define VLD_IMAGE_NWORDS  (sizeof(vldRegs) >> 2)
+
+/* Bus (big endian) to host byte order, 16 bytes at a time */
+static void
+vldImageSwap(uint32_t *word, uint32_t nwords)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  uint32_t iword = 0;
+#if defined(__GNUC__)
+  typedef uint8_t vldBytes16 __attribute__((vector_size(16)));
+  vldBytes16 v;
+
+  for(; iword + 4 <= nwords; iword += 4)
+    {
+      memcpy(&v, &word[iword], sizeof(v));
+#if defined(__clang__)
+      v = __builtin_shufflevector(v, v, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+#else
+      v = __builtin_shuffle(v, (vldBytes16) { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 });
+#endif
+      memcpy(&word[iword], &v, sizeof(v));
+    }
+#endif
+  for(; iword < nwords; iword++)
+    word[iword] = __builtin_bswap32(word[iword]);
+#endif
+}
+
+/* Readable words that change without being written (the counters).  The
+   others are kept in the shadow */
+#define VLD_COUNTER_WORDS  (1ULL << (offsetof(vldRegs, trigCnt) >> 2))
+
+/* Refresh the shadow with nwords read from register word iword */
+static void
+vldShadowUpdate(vldCrate *crate, int32_t id, uint32_t iword, const uint32_t *data, uint32_t nwords)
+{
+  uint64_t valid = 0;
+  uint32_t iw, word;
+
+  for(iw = 0; iw < nwords; iw++)
+    {
+      word = iword + iw;
+      if((word < 64) && (((vldReadableWords & ~VLD_COUNTER_WORDS) >> word) & 1))
+	{
+	  VLD_SHADOW_WORD(id, word) = data[iw];
+	  valid |= 1ULL << word;
+	}
+    }
+  __atomic_fetch_or(&crate->st->mod[id].shadowValid, valid, __ATOMIC_RELEASE);
+}
+
+/* Read nwords from offset of a module, with one block transfer if the
+   backend has them (and there's more than one word).  Otherwise, or if
+   the transfer fails, with a single cycle read of each readable register
+   (the other words are 0).  The configuration registers read refresh the
+   shadow, so changes made outside of the library are seen.  Called with
+   the module lock held */
+static int32_t
+vldWindowRead(vldCrate *crate, int32_t id, uint32_t offset, uint32_t nwords, uint32_t *data)
+{
+  volatile uint32_t *reg = (volatile uint32_t *)crate->mod[id].VLDp + (offset >> 2);
+  uint32_t iword, word;
+
+  if((nwords > 1) && (crate->vldBE->blockRead != NULL))
+    {
+      VSTATS_COUNT(blocks);
+      if(crate->vldBE->blockRead(reg, crate->st->mod[id].a24 + offset, data, nwords) == nwords)
+	{
+	  vldImageSwap(data, nwords);
+	  vldShadowUpdate(crate, id, offset >> 2, data, nwords);
+	  vldPublish(crate, id, offset >> 2, data, nwords, ~0ULL);
+	  return OK;
+	}
+    }
+
+  for(iword = 0; iword < nwords; iword++)
+    {
+      word = (offset >> 2) + iword;
+      data[iword] = ((word < 64) && ((vldReadableWords >> word) & 1)) ? vldRead32(&reg[iword]) : 0;
+    }
+  vldShadowUpdate(crate, id, offset >> 2, data, nwords);
+  vldPublish(crate, id, offset >> 2, data, nwords, ~0ULL);
+
+  return OK;
+}
+
+/* Read the register window of a module into image */
+static int32_t
+vldImageRead(vldCrate *crate, int32_t id, vldRegs *image)
+{
+  return vldWindowRead(crate, id, 0, VLD_IMAGE_NWORDS, (uint32_t *)image);
+}
+
+/* Decode the image of a module */
+static void
+vldStatusDecode(const vldRegs *image, uint32_t slot, uint32_t firmware, vldStatus *status)
+{
+  uint32_t iconn, low;
+
+  status->slot = slot;
+  status->firmware = firmware;
+  status->boardID = image->boardID;
+  status->trigSrc = image->trigSrc & VLD_TRIGSRC_MASK;
+  status->clockSrc = vldDecode_clockSrc_SOURCE(image->clockSrc);
+  status->trigDelay = vldDecode_trigDelay_DELAY(image->trigDelay);
+  status->trigDelayStep = vldDecode_trigDelay_STEP16NS(image->trigDelay);
+  status->trigWidth = vldDecode_trigDelay_WIDTH(image->trigDelay);
+  status->bleachTimer = vldDecode_bleachTime_TIMER(image->bleachTime);
+  status->bleachEnable =
+    ((image->bleachTime & VLD_BLEACHTIME_ENABLE_MASK) == VLD_BLEACHTIME_ENABLE);
+  status->calibrationWidth = vldDecode_calibrationWidth_WIDTH(image->calibrationWidth);
+  status->analogDelay = vldDecode_analogCtrl_DELAY(image->analogCtrl);
+  status->analogWidth = vldDecode_analogCtrl_WIDTH(image->analogCtrl);
+  status->randomPrescale = vldDecode_randomTrig_PRESCALE(image->randomTrig);
+  status->randomEnable = vldDecode_randomTrig_ENABLE(image->randomTrig);
+  status->periodicPeriod = vldDecode_periodicTrig_PERIOD(image->periodicTrig);
+  status->periodicNPulses = vldDecode_periodicTrig_NPULSES(image->periodicTrig);
+  status->trigCnt = image->trigCnt;
+
+  for(iconn = 0; iconn < 5; iconn++)
+    {
+      low = image->output[iconn].low_ctrl;
+      status->output[iconn].lochanEnableMask = vldDecode_ledLow_CHANNELS(low);
+      status->output[iconn].hichanEnableMask = vldDecode_ledHigh_CHANNELS(image->output[iconn].high);
+      status->output[iconn].ctrlLDO = vldDecode_ledLow_BLEACH_CTRL(low);
+      status->output[iconn].enableLDO = vldDecode_ledLow_BLEACH_REG_ENABLE(low) &&
+	((low & LED_CONTROL_BLEACH_ENABLE_MASK) == LED_CONTROL_BLEACH_ENABLE);
+    }
+}
+
+/* Read and decode the image of up to nstatus modules, in slot order.
+   The images are kept in images[slot], if not NULL */
+static int32_t
+vldStatusRead(vldCrate *crate, vldStatus *status, int32_t nstatus, vldRegs *images)
+{
+  vldRegs image;
+  int32_t slots[MAX_VME_SLOTS+1], nslots, iv, slot;
+
+  nslots = vldTableCopy(crate, slots);
+  if(nslots > nstatus)
+    nslots = nstatus;
+
+  for(iv = 0; iv < nslots; iv++)
+    {
+      slot = slots[iv];
+      VSLOCK_RD(slot);
+      vldImageRead(crate, slot, &image);
+      VSUNLOCK(slot);
+
+      vldStatusDecode(&image, slot, crate->st->mod[slot].fwVers, &status[iv]);
+      if(images != NULL)
+	memcpy(&images[slot], &image, sizeof(vldRegs));
+    }
+
+  return nslots;
+}
+/** \endcond */
+
+/**
+ * @brief Get the status of the initialized modules
+ * @details Read the register image of each initialized module, and
+ * decode it into status, in slot order.
+ * @param[in] crate Crate context
+ * @param[out] status Status of each module
+ * @param[in] nstatus Number of entries in status.  MAX_VME_SLOTS+1 is always enough.
+ * @return The number of modules in status, if successful.  Otherwise ERROR.
+ */
+int32_t
+vldCrateGetStatusSnapshot(vldCrate *crate, vldStatus *status, int32_t nstatus)
+{
+  VSTATS(vldGetStatusSnapshot, 0);
+
+  if((status == NULL) || (nstatus < 0))
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid status array");
+      return ERROR;
+    }
+
+  return vldStatusRead(crate, status, nstatus, NULL);
+}
+
+/**
+ * @brief vldCrateGetStatusSnapshot, for the default crate
+ */
+int32_t
+vldGetStatusSnapshot(vldStatus *status, int32_t nstatus)
+{
+  return vldCrateGetStatusSnapshot(&vldDefaultCrate, status, nstatus);
+}
+
+/** \cond PRIVATE */
+/* Attempts of vldGetPublishedStatus to copy an image that isn't changing,
+   and of them, those that spin while it's changed, before yielding the CPU
+   (to a writer that may have been preempted) */
+#define VLD_PUBLISHED_RETRIES  1024
+#define VLD_PUBLISHED_SPINS    64
+/** \endcond */
+
+/**
+ * @brief Get the published status of a module
+ * @details Decode the last known registers of the module, as published
+ * by the other routines whenever they read or write them, into status.
+ * No locks are taken and there is no bus access, so a monitor may call
+ * it as often as it likes without slowing down the other threads (or
+ * processes, for a shared crate).  The copy is consistent: it is taken
+ * again if it changes while it's copied.  The registers that haven't
+ * been read or written since the module was initialized are unknown,
+ * and the fields decoded from them are 0: they are the bits clear in
+ * valid.  Use vldCacheRefresh() or vldReadImage() to publish all of them.
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[out] status Status of the module
+ * @param[out] valid If not NULL, mask of the known registers (bit = register offset >> 2)
+ * @param[out] timestamp If not NULL, CLOCK_MONOTONIC time, in ns, of the last change
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateGetPublishedStatus(vldCrate *crate, int32_t id, vldStatus *status, uint64_t *valid,
+			   uint64_t *timestamp)
+{
+  vldModuleState *ms;
+  vldRegs image;
+  uint32_t seq, iword, itry;
+  uint64_t pubTime, pubValid;
+  VSTATS(vldGetPublishedStatus, id);
+
+  /* Not CHECKID: the published image doesn't need the mapping of a shared crate */
+  if((id < 0) || (id >= MAX_VME_SLOTS) ||
+     !(__atomic_load_n(&crate->st->vldSlotPresent, __ATOMIC_ACQUIRE) & (1 << id)))
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_NOT_INITIALIZED, id,
+	     "VLD id %d is not initialized", id);
+      return ERROR;
+    }
+
+  if(status == NULL)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, id, "Invalid status");
+      return ERROR;
+    }
+
+  ms = &crate->st->mod[id];
+  for(itry = 0; itry < VLD_PUBLISHED_RETRIES; itry++)
+    {
+      seq = __atomic_load_n(&ms->pubSeq, __ATOMIC_ACQUIRE);
+      if(seq & 1)
+	{
+	  if(itry >= VLD_PUBLISHED_SPINS)
+	    sched_yield();
+	  continue;
+	}
+
+      for(iword = 0; iword < (sizeof(vldRegs) >> 2); iword++)
+	((uint32_t *)&image)[iword] = __atomic_load_n(&VLD_PUBLISHED_WORD(id, iword), __ATOMIC_RELAXED);
+      pubTime = __atomic_load_n(&ms->pubTime, __ATOMIC_RELAXED);
+      pubValid = __atomic_load_n(&ms->pubValid, __ATOMIC_RELAXED);
+
+      /* The words are read before pubSeq is read again */
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if(__atomic_load_n(&ms->pubSeq, __ATOMIC_RELAXED) == seq)
+	break;
+    }
+
+  if(itry == VLD_PUBLISHED_RETRIES)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_BAD_STATE, id, "Published status kept changing");
+      return ERROR;
+    }
+
+  vldStatusDecode(&image, id, ms->fwVers, status);
+  if(valid != NULL)
+    *valid = pubValid;
+  if(timestamp != NULL)
+    *timestamp = pubTime;
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateGetPublishedStatus, for the default crate
+ */
+int32_t
+vldGetPublishedStatus(int32_t id, vldStatus *status, uint64_t *valid, uint64_t *timestamp)
+{
+  return vldCrateGetPublishedStatus(&vldDefaultCrate, id, status, valid, timestamp);
+}
+
+/** \cond PRIVATE */
+#define VLD_STATUS_NWORDS  (sizeof(vldStatus) >> 2)
+
+static inline void
+vldPutLE32(uint8_t *dest, uint32_t val)
+{
+  dest[0] = val;
+  dest[1] = val >> 8;
+  dest[2] = val >> 16;
+  dest[3] = val >> 24;
+}
+
+/* JSON document in a caller buffer.  len keeps counting past the end of
+   the buffer, for the error message */
+typedef struct
+{
+  char *buf;
+  size_t size;
+  size_t len;
+} vldJSON;
+
+static void
+vldJSONPut(vldJSON *js, const char *str)
+{
+  for(; *str; str++, js->len++)
+    {
+      if(js->len < js->size)
+	js->buf[js->len] = *str;
+    }
+}
+
+static void
+vldJSONPutU32(vldJSON *js, uint32_t val)
+{
+  char digits[11];
+  int32_t idigit = sizeof(digits) - 1;
+
+  digits[idigit] = 0;
+  do
+    {
+      digits[--idigit] = '0' + (val % 10);
+      val /= 10;
+    }
+  while(val);
+
+  vldJSONPut(js, &digits[idigit]);
+}
+
+/* "name":val, after *sep */
+static void
+vldJSONPutMember(vldJSON *js, const char **sep, const char *name, uint32_t val)
+{
+  vldJSONPut(js, *sep);
+  vldJSONPut(js, name);
+  vldJSONPut(js, "\":");
+  vldJSONPutU32(js, val);
+  *sep = ",\"";
+}
+/** \endcond */
+
+/**
+ * @brief Write status as a binary record
+ * @details Write the status of nstatus modules to buf: a header of 4
+ * little endian words (VLD_STATUS_MAGIC, VLD_STATUS_VERSION and the words
+ * per module << 16, nstatus, 0), then the members of each vldStatus as
+ * little endian words, in order.
+ * @param[in] status Status of each module, from vldGetStatusSnapshot
+ * @param[in] nstatus Number of entries in status
+ * @param[out] buf Buffer for the record
+ * @param[in] size Size of buf, in bytes
+ * @return The number of bytes written, if successful.  Otherwise ERROR.
+ */
+int32_t
+vldStatusToBinary(const vldStatus *status, int32_t nstatus, void *buf, size_t size)
+{
+  uint8_t *dest = (uint8_t *)buf;
+  const uint32_t *word;
+  size_t need;
+  int32_t istatus, iword;
+
+  if((nstatus < 0) || ((nstatus > 0) && (status == NULL)))
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid status array");
+      return ERROR;
+    }
+
+  need = (4 + nstatus * VLD_STATUS_NWORDS) << 2;
+  if((buf == NULL) || (size < need))
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1,
+	     "Buffer too small (%lu bytes).  Need %lu bytes.",
+	     (unsigned long)size, (unsigned long)need);
+      return ERROR;
+    }
+
+  vldPutLE32(&dest[0], VLD_STATUS_MAGIC);
+  vldPutLE32(&dest[4], VLD_STATUS_VERSION | (VLD_STATUS_NWORDS << 16));
+  vldPutLE32(&dest[8], nstatus);
+  vldPutLE32(&dest[12], 0);
+  dest += 16;
+
+  for(istatus = 0; istatus < nstatus; istatus++)
+    {
+      word = (const uint32_t *)&status[istatus];
+      for(iword = 0; iword < VLD_STATUS_NWORDS; iword++, dest += 4)
+	vldPutLE32(dest, word[iword]);
+    }
+
+  return need;
+}
+
+/**
+ * @brief Write status as a JSON document
+ * @details Write the status of nstatus modules to buf, as a NUL terminated
+ * JSON document:
+ *
+ *     {"modules":[{"slot":3,"firmware":36,...,"output":[{"lochanEnableMask":...},...]},...]}
+ *
+ * with the members of vldStatus, in order.
+ * @param[in] status Status of each module, from vldGetStatusSnapshot
+ * @param[in] nstatus Number of entries in status
+ * @param[out] buf Buffer for the document
+ * @param[in] size Size of buf, in bytes
+ * @return The length of the document, if successful.  Otherwise ERROR.
+ */
+int32_t
+vldStatusToJSON(const vldStatus *status, int32_t nstatus, char *buf, size_t size)
+{
+  vldJSON js = { buf, size, 0 };
+  const char *sep;
+  int32_t istatus, iconn;
+
+  if((nstatus < 0) || ((nstatus > 0) && (status == NULL)) || (buf == NULL))
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid status array, or buffer");
+      return ERROR;
+    }
+
+  vldJSONPut(&js, "{\"modules\":[");
+  for(istatus = 0; istatus < nstatus; istatus++)
+    {
+      vldJSONPut(&js, istatus ? ",{" : "{");
+
+      sep = "\"";
+#define VLD_JSON_MEMBER(_name)						\
+      vldJSONPutMember(&js, &sep, #_name, status[istatus]._name);
+      VLD_STATUS_FIELDS(VLD_JSON_MEMBER)
+#undef VLD_JSON_MEMBER
+
+      vldJSONPut(&js, ",\"output\":[");
+      for(iconn = 0; iconn < 5; iconn++)
+	{
+	  vldJSONPut(&js, iconn ? ",{" : "{");
+	  sep = "\"";
+#define VLD_JSON_MEMBER(_name)						\
+	  vldJSONPutMember(&js, &sep, #_name, status[istatus].output[iconn]._name);
+	  VLD_OUTPUT_STATUS_FIELDS(VLD_JSON_MEMBER)
+#undef VLD_JSON_MEMBER
+	  vldJSONPut(&js, "}");
+	}
+      vldJSONPut(&js, "]}");
+    }
+  vldJSONPut(&js, "]}");
+
+  if(js.len >= size)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1,
+	     "Buffer too small (%lu bytes).  Need %lu bytes.",
+	     (unsigned long)size, (unsigned long)js.len + 1);
+      if(size)
+	buf[0] = 0;
+      return ERROR;
+    }
+  buf[js.len] = 0;
+
+  return js.len;
+}
+
+/** \cond PRIVATE */
+_Static_assert(VLD_STATUS_NWORDS <= 64, "vldStatus words must fit the delta mask");
+
+/* Mask of the words that differ, 4 at a time */
+static uint64_t
+vldDiffWords(const uint32_t *a, const uint32_t *b, uint32_t nwords)
+{
+  uint64_t mask = 0;
+  uint32_t iword = 0;
+#if defined(__GNUC__)
+  typedef uint32_t vldWords4 __attribute__((vector_size(16)));
+  typedef int32_t vldFlags4 __attribute__((vector_size(16)));
+  vldWords4 va, vb;
+  vldFlags4 ne;
+
+  for(; iword + 4 <= nwords; iword += 4)
+    {
+      memcpy(&va, &a[iword], sizeof(va));
+      memcpy(&vb, &b[iword], sizeof(vb));
+      ne = (va != vb);
+      mask |= (uint64_t)((ne[0] & 1) | (ne[1] & 2) | (ne[2] & 4) | (ne[3] & 8)) << iword;
+    }
+#endif
+  for(; iword < nwords; iword++)
+    {
+      if(a[iword] != b[iword])
+	mask |= 1ULL << iword;
+    }
+
+  return mask;
+}
+
+static inline void
+vldPutLE64(uint8_t *dest, uint64_t val)
+{
+  vldPutLE32(dest, val);
+  vldPutLE32(dest + 4, val >> 32);
+}
+
+static inline uint32_t
+vldGetLE32(const uint8_t *src)
+{
+  return src[0] | (src[1] << 8) | (src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static inline uint64_t
+vldGetLE64(const uint8_t *src)
+{
+  return vldGetLE32(src) | ((uint64_t)vldGetLE32(src + 4) << 32);
+}
+/** \endcond */
+
+/**
+ * @brief Get the changes in status since a previous call
+ * @details Read the status of the initialized modules, as
+ * vldGetStatusSnapshot, and write to buf only the modules, and the words
+ * of their vldStatus, that changed since the call that returned since
+ * (see VLD_DELTA_MAGIC for the encoding).  The words are compared 4 at a
+ * time.  The snapshot of each call is kept for the next call with its
+ * token, and replaces the one of since, so each consumer (slow controls,
+ * an archiver, ...) has its own, up to VLD_DELTA_CONSUMERS of them.  If
+ * since is 0, or its snapshot isn't kept (the least recently used are
+ * dropped for new consumers), buf has every module (VLD_DELTA_FULL).
+ * @param[in] crate Crate context
+ * @param[in] since Token from the previous call, or 0
+ * @param[out] token Token of this call
+ * @param[out] buf Buffer for the delta
+ * @param[in] size Size of buf, in bytes.  (MAX_VME_SLOTS+1) * (10 + sizeof(vldStatus)) + 16 is always enough.
+ * @return The number of bytes written, if successful.  Otherwise ERROR,
+ * and the previous token is still valid.
+ */
+int32_t
+vldCrateGetStatusDelta(vldCrate *crate, uint64_t since, uint64_t *token, void *buf, size_t size)
+{
+  vldStatus status[MAX_VME_SLOTS+1], now[MAX_VME_SLOTS+1];
+  uint8_t *dest = (uint8_t *)buf, *end = dest + size;
+  vldDeltaBase *base;
+  uint64_t mask, newToken;
+  uint32_t nowMask = 0, iword, nrecords = 0, flags, ibase;
+  int32_t nslots, istatus, id, full, rval;
+  struct timespec ts;
+  VSTATS(vldGetStatusDelta, 0);
+
+  if((token == NULL) || (buf == NULL) || (size < 16))
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid token, or buffer");
+      return ERROR;
+    }
+
+  VLOCKCALL(pthread_mutex_lock, &crate->deltaMutex);
+
+  nslots = vldStatusRead(crate, status, MAX_VME_SLOTS+1, NULL);
+  for(istatus = 0; istatus < nslots; istatus++)
+    {
+      id = status[istatus].slot;
+      now[id] = status[istatus];
+      nowMask |= 1 << id;
+    }
+
+  /* The snapshot of since, or else the least recently used, for this call's */
+  base = &crate->delta[0];
+  for(ibase = 0; ibase < VLD_DELTA_CONSUMERS; ibase++)
+    {
+      if((since != 0) && (crate->delta[ibase].token == since))
+	{
+	  base = &crate->delta[ibase];
+	  break;
+	}
+      if(crate->delta[ibase].token < base->token)
+	base = &crate->delta[ibase];
+    }
+  full = (since == 0) || (base->token != since);
+  dest += 16;
+
+  VLD_FOREACH_SLOT(id, nowMask | (full ? 0 : base->mask))
+    {
+      flags = 0;
+      if(!(nowMask & (1 << id)))
+	{
+	  flags = VLD_DELTA_REMOVED;
+	  mask = 0;
+	}
+      else if(full || !(base->mask & (1 << id)))
+	mask = (VLD_STATUS_NWORDS == 64) ? ~0ULL : ((1ULL << VLD_STATUS_NWORDS) - 1);
+      else
+	{
+	  mask = vldDiffWords((const uint32_t *)&now[id], (const uint32_t *)&base->base[id],
+			      VLD_STATUS_NWORDS);
+	  if(mask == 0)
+	    continue;
+	}
+
+      if(dest + 10 + (__builtin_popcountll(mask) << 2) > end)
+	{
+	  VLOCKCALL(pthread_mutex_unlock, &crate->deltaMutex);
+	  vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Buffer too small (%lu bytes)",
+		 (unsigned long)size);
+	  return ERROR;
+	}
+
+      dest[0] = id;
+      dest[1] = flags;
+      vldPutLE64(&dest[2], mask);
+      dest += 10;
+      for(; mask; mask &= mask - 1, dest += 4)
+	{
+	  iword = __builtin_ctzll(mask);
+	  vldPutLE32(dest, ((const uint32_t *)&now[id])[iword]);
+	}
+      nrecords++;
+    }
+
+  /* Increasing, and not reused after a restart */
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  newToken = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  if(newToken <= crate->deltaLast)
+    newToken = crate->deltaLast + 1;
+
+  rval = dest - (uint8_t *)buf;
+  dest = (uint8_t *)buf;
+  vldPutLE32(&dest[0], VLD_DELTA_MAGIC);
+  vldPutLE32(&dest[4], VLD_STATUS_VERSION | ((full ? VLD_DELTA_FULL : 0) << 8) | (nrecords << 16));
+  vldPutLE64(&dest[8], newToken);
+
+  VLD_FOREACH_SLOT(id, nowMask)
+    {
+      base->base[id] = now[id];
+    }
+  base->mask = nowMask;
+  base->token = newToken;
+  crate->deltaLast = newToken;
+  *token = newToken;
+
+  VLOCKCALL(pthread_mutex_unlock, &crate->deltaMutex);
+
+  return rval;
+}
+
+/**
+ * @brief vldCrateGetStatusDelta, for the default crate
+ */
+int32_t
+vldGetStatusDelta(uint64_t since, uint64_t *token, void *buf, size_t size)
+{
+  return vldCrateGetStatusDelta(&vldDefaultCrate, since, token, buf, size);
+}
+
+/**
+ * @brief Apply a status delta
+ * @details Update status, and slotMask, with a delta from
+ * vldGetStatusDelta.  A full delta (VLD_DELTA_FULL) replaces them.
+ * @param[in,out] status Status of each module, indexed by slot ID.  MAX_VME_SLOTS+1 entries.
+ * @param[in,out] slotMask Mask of the slots in status
+ * @param[in] buf Delta
+ * @param[in] len Length of the delta, in bytes
+ * @return The number of records applied, if successful.  Otherwise ERROR.
+ */
+int32_t
+vldStatusApplyDelta(vldStatus *status, uint32_t *slotMask, const void *buf, size_t len)
+{
+  const uint8_t *src = (const uint8_t *)buf, *end = src + len;
+  uint64_t mask;
+  uint32_t header, nrecords, irecord, id, flags;
+
+  if((status == NULL) || (slotMask == NULL) || (buf == NULL) || (len < 16) ||
+     (vldGetLE32(src) != VLD_DELTA_MAGIC) ||
+     (((header = vldGetLE32(src + 4)) & 0xFF) != VLD_STATUS_VERSION))
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid status delta");
+      return ERROR;
+    }
+
+  nrecords = header >> 16;
+  if((header >> 8) & VLD_DELTA_FULL)
+    *slotMask = 0;
+  src += 16;
+
+  for(irecord = 0; irecord < nrecords; irecord++)
+    {
+      if(src + 10 > end)
+	break;
+
+      id = src[0];
+      flags = src[1];
+      mask = vldGetLE64(&src[2]);
+      src += 10;
+
+      if((id > MAX_VME_SLOTS) || (mask >> (VLD_STATUS_NWORDS - 1) >> 1) ||
+	 (src + (__builtin_popcountll(mask) << 2) > end))
+	break;
+
+      if(flags & VLD_DELTA_REMOVED)
+	{
+	  *slotMask &= ~(1 << id);
+	  continue;
+	}
+
+      if(!(*slotMask & (1 << id)))
+	memset(&status[id], 0, sizeof(vldStatus));
+      *slotMask |= (1 << id);
+
+      for(; mask; mask &= mask - 1, src += 4)
+	((uint32_t *)&status[id])[__builtin_ctzll(mask)] = vldGetLE32(src);
+    }
+
+  if(irecord < nrecords)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Truncated status delta");
+      return ERROR;
+    }
+
+  return nrecords;
+}
+
+/**
+ * @brief Show the settings and status of the initialized VLD
+ * @param[in] crate Crate context
+ * @param[in] pFlag Print option bits
+ *     bit | desc
+ *       -|-
+ *       0 | Also show each readable register, and its fields, of each module
+ */
+void
+vldCrateGStatus(vldCrate *crate, int32_t pFlag)
+{
+  vldRegs rb[MAX_VME_SLOTS+1];
+  vldStatus status[MAX_VME_SLOTS+1];
+  const vldStatus *st;
+  uint32_t iv, slot, iconn, ireg, ifield, rval;
+  int32_t nslots;
+  VSTATS(vldGStatus, 0);
+
+  nslots = vldStatusRead(crate, status, MAX_VME_SLOTS+1, rb);
+
+  printf("VLD Module Status Summary\n");
+
+  printf("         Firmware  Trigger Source........................            Clock...\n");
+  printf("Slot     Version   Periodic  Random    Sequence  External            Source\n");
+  printf("--------------------------------------------------------------------------------\n");
+  /* printf("13       0x1234    Enabled   Enabled   Enabled   Enabled             External"); */
+
+  for(iv = 0; iv < nslots; iv++)
+    {
+      st = &status[iv];
+
+      /* Slot */
+      printf("%2d       ", st->slot);
+
+      printf("0x%02x      ", st->firmware);
+
+      printf("%s  ", (st->trigSrc & VLD_TRIGSRC_INTERNAL_PERIODIC_ENABLE) ?
+	     "Enabled " : "Disabled");
+
+      printf("%s  ", (st->trigSrc & VLD_TRIGSRC_INTERNAL_RANDOM_ENABLE) ?
+	     "Enabled " : "Disabled");
+
+      printf("%s  ", (st->trigSrc & VLD_TRIGSRC_INTERNAL_SEQUENCE_ENABLE) ?
+	     "Enabled " : "Disabled");
+
+      printf("%s            ", (st->trigSrc & VLD_TRIGSRC_EXTERNAL_ENABLE) ?
+	     "Enabled " : "Disabled");
+
+      printf("%s", (st->clockSrc == VLD_CLOCK_EXTERNAL) ?
+	     "External" : "Internal");
+
+      printf("\n");
+    }
+
+  printf("\n");
+  printf("         Bleach Timer.....   Calibration.....    Analog Switch.....\n");
+  printf("Slot     Time[ms]  Status    Pulse Width[ns]     Delay[ns] Width[ns]\n");
+  printf("--------------------------------------------------------------------------------\n");
+  /* printf("13       123456789 Enabled   4092                1024      508"); */
+
+  for(iv = 0; iv < nslots; iv++)
+    {
+      st = &status[iv];
+
+      /* Slot */
+      printf("%2d       ", st->slot);
+
+      printf("%10u ", (int)
+	     (st->bleachTimer * 20 * 1024 * 1024) / 1000);
+
+      printf("%s  ", st->bleachEnable ? "Enabled " : "Disabled");
+
+      printf("%4d                ", st->calibrationWidth * 4);
+
+      printf("%4d      ", st->analogDelay * 4);
+
+      printf("%3d", st->analogWidth * 4);
+
+      printf("\n");
+    }
+
+  printf("\n");
+  printf("         Random Pulser..............   Periodic Pulser............\n");
+  printf("Slot     Prescale  Rate[kHz] Status    Period    npulses\n");
+  printf("--------------------------------------------------------------------------------\n");
+  /* printf("13       7         700000    Enabled   1234.123  12345151"); */
+
+  for(iv = 0; iv < nslots; iv++)
+    {
+      st = &status[iv];
+
+      /* Slot */
+      printf("%2d       ", st->slot);
+
+      printf("%d         ", st->randomPrescale);
+
+      printf("%6d   ", 700000 >> st->randomPrescale);
+
+      printf("%s  ", st->randomEnable ? "Enabled " : "Disabled");
+
+      printf("%7d  ", 120 + 30 * st->periodicPeriod);
+
+      printf("%d", st->periodicNPulses);
+
+      printf("\n");
+    }
+
+  printf("\n");
+  printf("         LED Outputs.......................................\n");
+  printf("Slot     Connector Ch 1-18   Ch 19-36  Bleach    Status\n");
+  printf("--------------------------------------------------------------------------------\n");
+  /* printf("13       4         0x3ffff   0x3ffff   7         Enabled "); */
+
+  for(iv = 0; iv < nslots; iv++)
+    {
+      st = &status[iv];
+
+      for(iconn = 0; iconn < 5; iconn++)
+	{
+	  printf("%2d       %d         0x%05x   0x%05x   %d         %s\n", st->slot, iconn,
+		 st->output[iconn].lochanEnableMask, st->output[iconn].hichanEnableMask,
+		 st->output[iconn].ctrlLDO,
+		 st->output[iconn].enableLDO ? "Enabled " : "Disabled");
+	}
+    }
+
+  if(!(pFlag & 1))
+    return;
+
+  for(iv = 0; iv < nslots; iv++)
+    {
+      slot = status[iv].slot;
+
+      printf("\nSlot %d Registers\n", slot);
+      printf("--------------------------------------------------------------------------------\n");
+
+      for(ireg = 0; ireg < VLD_REG_NREG; ireg++)
+	{
+	  if(!(vldRegTable[ireg].access & VLD_REG_RO))
+	    continue;
+
+	  rval = *(uint32_t *)((uintptr_t)&rb[slot] + vldRegTable[ireg].offset);
+	  printf("0x%03x  %-20s 0x%08x ", vldRegTable[ireg].offset,
+		 vldRegTable[ireg].name, rval);
+
+	  for(ifield = 0; ifield < VLD_FIELD_NFIELD; ifield++)
+	    {
+	      if(strcmp(vldFieldTable[ifield].group, vldRegTable[ireg].group) != 0)
+		continue;
+
+	      printf(" %s=0x%x", vldFieldTable[ifield].name,
+		     (uint32_t)((rval >> vldFieldTable[ifield].shift) &
+				((1ULL << vldFieldTable[ifield].width) - 1)));
+	    }
+	  printf("\n");
+	}
+    }
+}
+
+/**
+ * @brief vldCrateGStatus, for the default crate
+ */
+void
+vldGStatus(int32_t pFlag)
+{
+  vldCrateGStatus(&vldDefaultCrate, pFlag);
+}
+
+/**
+ * @brief Read the registers of a module
+ * @details Read the register window (0x000 - 0x104) of the specified
+ * module into image, with a single block transfer when the backend has
+ * them.  Otherwise, each readable register is read with a single cycle,
+ * and the rest of the image is 0.  The register cache is refreshed with
+ * the configuration registers read.  Decode the image with the
+ * vldDecode_ routines.
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[out] image Register image
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateReadImage(vldCrate *crate, int32_t id, vldRegs *image)
+{
+  int32_t rval;
+  VSTATS(vldReadImage, id);
+  CHECKID(id);
+
+  VSLOCK_RD(id);
+  rval = vldImageRead(crate, id, image);
+  VSUNLOCK(id);
+
+  return rval;
+}
+
+/**
+ * @brief vldCrateReadImage, for the default crate
+ */
+int32_t
+vldReadImage(int32_t id, vldRegs *image)
+{
+  return vldCrateReadImage(&vldDefaultCrate, id, image);
+}
+
+/**
+ * @brief Read registers of several modules at once
+ * @details Read nwords, from offset of the register window, of each
+ * initialized module in slotMask.  With a backend that has chained block
+ * reads (CBLT), the modules are read in one transaction.  Otherwise, each
+ * module is read with a block transfer, or with single cycle reads.
+ * @param[in] crate Crate context
+ * @param[in] slotMask Mask of slots to read
+ * @param[in] offset Offset of the first register, in the register window
+ * @param[in] nwords Number of registers, from offset, of each module
+ * @param[out] data nwords of each module read, in slot order
+ * @return The number of modules read, if successful.  Otherwise ERROR.
+ */
+int32_t
+vldCrateGReadWindow(vldCrate *crate, uint32_t slotMask, uint32_t offset, uint32_t nwords,
+		    uint32_t *data)
+{
+  int32_t id, nslots = 0;
+  VSTATS(vldGReadWindow, 0);
+  VSYNC;
+
+  if((offset & 0x3) || (nwords == 0) || (offset + (nwords << 2) > sizeof(vldRegs)))
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1,
+	     "Invalid window (offset 0x%x, %u words)", offset, nwords);
+      return ERROR;
+    }
+
+  slotMask &= __atomic_load_n(&crate->st->vldSlotPresent, __ATOMIC_ACQUIRE);
+
+  /* Slot order, so concurrent calls don't deadlock */
+  VLD_FOREACH_SLOT(id, slotMask)
+    {
+      VSLOCK_RD(id);
+      nslots++;
+    }
+
+  if(crate->vldBE->chainedRead != NULL)
+    {
+      VSTATS_COUNT(blocks);
+      if(crate->vldBE->chainedRead(slotMask, offset, data, nwords) == nslots * nwords)
+	{
+	  vldImageSwap(data, nslots * nwords);
+	  nslots = 0;
+	  VLD_FOREACH_SLOT(id, slotMask)
+	    {
+	      vldShadowUpdate(crate, id, offset >> 2, &data[nslots * nwords], nwords);
+	      vldPublish(crate, id, offset >> 2, &data[nslots * nwords], nwords, ~0ULL);
+	      nslots++;
+	    }
+	  goto unlock;
+	}
+    }
+
+  nslots = 0;
+  VLD_FOREACH_SLOT(id, slotMask)
+    {
+      vldWindowRead(crate, id, offset, nwords, &data[nslots * nwords]);
+      nslots++;
+    }
+
+ unlock:
+  VLD_FOREACH_SLOT(id, slotMask)
+    {
+      VSUNLOCK(id);
+    }
+
+  return nslots;
+}
+
+/**
+ * @brief vldCrateGReadWindow, for the default crate
+ */
+int32_t
+vldGReadWindow(uint32_t slotMask, uint32_t offset, uint32_t nwords, uint32_t *data)
+{
+  return vldCrateGReadWindow(&vldDefaultCrate, slotMask, offset, nwords, data);
+}
+
+/**
+ * @brief Set the trigger delay and pulse width
+
+ * @details For the specified slot id, update the trigger delay and
+ * pulse width.
+ * The output pulse delay is determined by
+ *
+ *     out_delay [ns] = 1024 * (delaystep) + (delay + 1) * 4 * 4**(delaystep)
+ *
+ * The output pulse width is determined by
+ *
+ *     out_width [ns] = (width + 1) * 4
+ *
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[in] delay `[0,127]` Delay value, units determined by delaystep
+ * @param[in] delaystep `[0,1]` Delay units
+ *     delaystep | value
+ *     ----------|-------
+ *      0        | 4ns
+ *      1        | 16ns
+ * @param[in] width `[0, 31]` Width value, units of `4ns`
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateSetTriggerDelayWidth(vldCrate *crate, int32_t id, int32_t delay, int32_t delaystep, int32_t width)
+{
+  uint32_t wval=0;
+  VSTATS(vldSetTriggerDelayWidth, id);
+  CHECKID(id);
+
+  VLD_CHECK_FIELD(trigDelay, DELAY, delay, "delay");
+  VLD_CHECK_FIELD(trigDelay, WIDTH, width, "width");
+
+  wval = vldEncode_trigDelay_DELAY(delay) |
+    vldEncode_trigDelay_STEP16NS(delaystep ? 1 : 0) |
+    vldEncode_trigDelay_WIDTH(width);
+
+  VSLOCK_WR(id);
+
+  vldCacheWrite(crate, id, &crate->mod[id].VLDp->trigDelay, wval);
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateSetTriggerDelayWidth, for the default crate
+ */
+int32_t
+vldSetTriggerDelayWidth(int32_t id, int32_t delay, int32_t delaystep, int32_t width)
+{
+  return vldCrateSetTriggerDelayWidth(&vldDefaultCrate, id, delay, delaystep, width);
+}
+
+/**
+ * @brief Get the trigger pulse delay and width parameters
+ * @details For the specified slot id, return the trigger delay and
+ * pulse width parameters.
+ * The output pulse delay is determined by
+ *
+ *     out_delay [ns] = 1024 * (delaystep) + (delay + 1) * 4 * 4**(delaystep)
+ *
+ * The output pulse width is determined by
+ *
+ *     out_width [ns] = (width + 1) * 4
+ *
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[out] delay Delay value, units determined by delaystep
+ * @param[out] delaystep Delay units
+ * @param[out] width Width value
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateGetTriggerDelayWidth(vldCrate *crate, int32_t id, int32_t *delay, int32_t *delaystep, int32_t *width)
+{
+  uint32_t rval=0;
+  VSTATS(vldGetTriggerDelayWidth, id);
+  CHECKID(id);
+
+  VSLOCK_RD(id);
+  rval = vldCacheRead(crate, id, &crate->mod[id].VLDp->trigDelay);
+
+  *delay = vldDecode_trigDelay_DELAY(rval);
+  *delaystep = vldDecode_trigDelay_STEP16NS(rval);
+  *width = vldDecode_trigDelay_WIDTH(rval);
+
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateGetTriggerDelayWidth, for the default crate
+ */
+int32_t
+vldGetTriggerDelayWidth(int32_t id, int32_t *delay, int32_t *delaystep, int32_t *width)
+{
+  return vldCrateGetTriggerDelayWidth(&vldDefaultCrate, id, delay, delaystep, width);
+}
+
+/**
+ * @brief Set the trigger source mask
+ * @details Set the trigger source of the specified VLD using the bits:
+ *    bit | trigger source
+ *       -|-
+ *     0  | internal periodic
+ *     1  | internal random
+ *     2  | internal sequence
+ *     4  | external input
+ *
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[in] trigSrc trigger source mask
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateSetTriggerSourceMask(vldCrate *crate, int32_t id, uint32_t trigSrc)
+{
+  VSTATS(vldSetTriggerSourceMask, id);
+  CHECKID(id);
+
+  if((trigSrc & ~VLD_TRIGSRC_MASK) != 0)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, id,
+	     "Invalid trigSrc Mask (0x%x).  Allowed bits in mask 0x%x",
+	     trigSrc, VLD_TRIGSRC_MASK);
+      return ERROR;
+    }
+
+  VSLOCK_WR(id);
+  vldCacheWrite(crate, id, &crate->mod[id].VLDp->trigSrc, trigSrc);
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateSetTriggerSourceMask, for the default crate
+ */
+int32_t
+vldSetTriggerSourceMask(int32_t id, uint32_t trigSrc)
+{
+  return vldCrateSetTriggerSourceMask(&vldDefaultCrate, id, trigSrc);
+}
+
+/**
+ * @brief Get the trigger source mask
+ * @details Get the trigger source of the specified VLD. Trigger bits are:
+ *    bit | trigger source
+ *       -|-
+ *     0  | internal periodic
+ *     1  | internal random
+ *     2  | internal sequence
+ *     4  | external input
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[out] trigSrc Enabled Trigger Source mask
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateGetTriggerSourceMask(vldCrate *crate, int32_t id, uint32_t *trigSrc)
+{
+  VSTATS(vldGetTriggerSourceMask, id);
+  CHECKID(id);
+
+  VSLOCK_RD(id);
+  *trigSrc = vldCacheRead(crate, id, &crate->mod[id].VLDp->trigSrc) & VLD_TRIGSRC_MASK;
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateGetTriggerSourceMask, for the default crate
+ */
+int32_t
+vldGetTriggerSourceMask(int32_t id, uint32_t *trigSrc)
+{
+  return vldCrateGetTriggerSourceMask(&vldDefaultCrate, id, trigSrc);
+}
+
+
+/** \cond PRIVATE */
+/* Wait out the settle interval, then issue the DCM reset to each module of the switch */
+static void *
+vldClockSwitchThread(void *arg)
+{
+  vldClockSwitch *cs = (vldClockSwitch *)arg;
+  vldCrate *crate = cs->crate;
+  uint32_t rdata = 0;
+  int32_t id, status;
+
+  while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &cs->deadline, NULL) == EINTR)
+    ;
+
+  VLD_FOREACH_SLOT(id, cs->slotMask)
+    {
+      {
+	VSTATS(vldClockSwitchThread, id);
+	VSLOCK_WR(id);
+	/* Writes are posted.  Check that the clock source took, before the DCM reset */
+	status = ERROR;
+	if((vldCrateSlotMask(crate) & (1 << id)) == 0)
+	  {
+	    vldLog(VLD_LOG_ERROR, VLD_ERR_NO_MODULE, id, "Module removed during the clock switch");
+	  }
+	else
+	  {
+	    VSTATS_COUNT(probes);
+	    if(crate->vldBE->memProbe(&crate->mod[id].VLDp->clockSrc, &rdata) < 0)
+	      vldLog(VLD_LOG_ERROR, VLD_ERR_BUS, id, "No response reading clockSrc");
+	    else if((rdata & VLD_CLOCK_MASK) != cs->clkSrc)
+	      vldLog(VLD_LOG_ERROR, VLD_ERR_BUS, id,
+		     "Clock source not set (clockSrc 0x%08x, expected %d)", rdata, cs->clkSrc);
+	    else
+	      {
+		vldWrite32(&crate->mod[id].VLDp->reset, VLD_RESET_CLK);
+		status = OK;
+	      }
+	  }
+	VSUNLOCK(id);
+      }
+
+      if(status == OK)
+	__atomic_fetch_or(&cs->doneMask, 1 << id, __ATOMIC_RELEASE);
+
+      if(cs->callback)
+	(*cs->callback)(id, status, cs->arg);
+    }
+
+  return NULL;
+}
+
+/* Start a clock source switch.  The rest of it is done by a background
+   thread if spawn, otherwise by the calling thread before returning */
+static int32_t
+vldClockSwitchStart(vldCrate *crate, vldClockSwitch *cs, uint32_t slotMask, uint32_t clkSrc,
+		    vldClockDoneFunction callback, void *arg, int32_t spawn)
+{
+  int32_t id;
+
+  if(cs == NULL)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid switch structure");
+      return ERROR;
+    }
+
+  if(clkSrc > 1)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid clkSrc (%d)", clkSrc);
+      return ERROR;
+    }
+
+  cs->crate = crate;
+  cs->slotMask = slotMask & vldCrateSlotMask(crate);
+  cs->doneMask = 0;
+  cs->clkSrc = clkSrc;
+  cs->callback = callback;
+  cs->arg = arg;
+  cs->threadStarted = 0;
+
+  /* Nothing to settle */
+  if(cs->slotMask == 0)
+    return OK;
+
+  VLD_FOREACH_SLOT(id, cs->slotMask)
+    {
+      VSLOCK_WR(id);
+      vldCacheWriteNow(crate, id, &crate->mod[id].VLDp->clockSrc, clkSrc);
+      VSUNLOCK(id);
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &cs->deadline);
+  cs->deadline.tv_sec += VLD_CLOCK_SETTLE_US / 1000000;
+  cs->deadline.tv_nsec += (VLD_CLOCK_SETTLE_US % 1000000) * 1000;
+  if(cs->deadline.tv_nsec >= 1000000000)
+    {
+      cs->deadline.tv_sec++;
+      cs->deadline.tv_nsec -= 1000000000;
+    }
+
+  cs->threadStarted = spawn &&
+    (pthread_create(&cs->thread, NULL, vldClockSwitchThread, cs) == 0);
+  if(!cs->threadStarted)
+    {
+      if(spawn)
+	vldLog(VLD_LOG_ERROR, VLD_ERR_SYSTEM, -1, "pthread_create failed");
+      /* Finish the switch in this thread */
+      vldClockSwitchThread(cs);
+    }
+
+  return OK;
+}
+/** \endcond */
+
+/**
+ * @brief Start a clock source switch of several modules
+ * @details Write the clock source of each specified module, then return.
+ * The modules share a single settle interval (VLD_CLOCK_SETTLE_US),
+ * after which a background thread checks that each module reads back the
+ * clock source, issues its clock DCM reset, and calls the callback (if
+ * provided).  A module that was removed, does not respond, or did not
+ * take the clock source, is not reset, and its callback status is ERROR.
+ * Module locks are not held during the settle interval.  An empty
+ * slotMask returns at once.  The caller must keep the switch structure
+ * until vldClockSwitchWait has returned.
+ * @param[in] crate Crate context
+ * @param[out] cs Switch structure to track the switch
+ * @param[in] slotMask Mask of slot IDs.  Slots that are not initialized are ignored.
+ * @param[in] clkSrc `[0,1]` Selected Clock Source
+ *       clkSrc | desc
+ *             -|-
+ *         0    | Onboard Oscillator
+ *         1    | External LEMO connector input
+ * @param[in] callback If not NULL, called as callback(id, status, arg) for each module, status OK once its DCM reset is issued
+ * @param[in] arg Argument passed to callback
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateSetClockSourceAsync(vldCrate *crate, vldClockSwitch *cs, uint32_t slotMask, uint32_t clkSrc,
+			    vldClockDoneFunction callback, void *arg)
+{
+  VSTATS(vldSetClockSourceAsync, 0);
+
+  return vldClockSwitchStart(crate, cs, slotMask, clkSrc, callback, arg, 1);
+}
+
+/**
+ * @brief vldCrateSetClockSourceAsync, for the default crate
+ */
+int32_t
+vldSetClockSourceAsync(vldClockSwitch *cs, uint32_t slotMask, uint32_t clkSrc,
+		       vldClockDoneFunction callback, void *arg)
+{
+  return vldCrateSetClockSourceAsync(&vldDefaultCrate, cs, slotMask, clkSrc, callback, arg);
+}
+
+/**
+ * @brief Wait for a clock source switch to complete
+ * @details Block until the clock DCM reset has been issued to each
+ * module of the switch started by vldSetClockSourceAsync.
+ * @param[in] cs Switch structure
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldClockSwitchWait(vldClockSwitch *cs)
+{
+  if(cs == NULL)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid switch structure");
+      return ERROR;
+    }
+
+  if(cs->threadStarted)
+    {
+      pthread_join(cs->thread, NULL);
+      cs->threadStarted = 0;
+    }
+
+  return (cs->doneMask == cs->slotMask) ? OK : ERROR;
+}
+
+/**
+ * @brief Return the modules of a clock source switch that have completed
+ * @param[in] cs Switch structure
+ * @return Mask of slot IDs whose clock DCM reset has been issued
+ */
+uint32_t
+vldClockSwitchDoneMask(vldClockSwitch *cs)
+{
+  return __atomic_load_n(&cs->doneMask, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Set the clock source
+ * @details Set the clock source for the specified VLD modlue.  Waits
+ * for the clock to settle, and then resets the clock DCM.
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[in] clkSrc `[0,1]` Selected Clock Source
+ *       clkSrc | desc
+ *             -|-
+ *         0    | Onboard Oscillator
+ *         1    | External LEMO connector input
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateSetClockSource(vldCrate *crate, int32_t id, uint32_t clkSrc)
+{
+  vldClockSwitch cs;
+  VSTATS(vldSetClockSource, id);
+  CHECKID(id);
+
+  if(vldClockSwitchStart(crate, &cs, 1 << id, clkSrc, NULL, NULL, 0) != OK)
+    return ERROR;
+
+  return vldClockSwitchWait(&cs);
+}
+
+/**
+ * @brief vldCrateSetClockSource, for the default crate
+ */
+int32_t
+vldSetClockSource(int32_t id, uint32_t clkSrc)
+{
+  return vldCrateSetClockSource(&vldDefaultCrate, id, clkSrc);
+}
+
+/**
+ * @brief Set the clock source of all initialized modules
+ * @details Set the clock source for all initialized VLD modules, with a
+ * single settle interval for the crate.  Returns after each module's
+ * clock DCM has been reset.
+ * @param[in] crate Crate context
+ * @param[in] clkSrc `[0,1]` Selected Clock Source
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateGSetClockSource(vldCrate *crate, uint32_t clkSrc)
+{
+  vldClockSwitch cs;
+  VSTATS(vldGSetClockSource, 0);
+
+  if(vldClockSwitchStart(crate, &cs, vldCrateSlotMask(crate), clkSrc, NULL, NULL, 0) != OK)
+    return ERROR;
+
+  return vldClockSwitchWait(&cs);
+}
+
+/**
+ * @brief vldCrateGSetClockSource, for the default crate
+ */
+int32_t
+vldGSetClockSource(uint32_t clkSrc)
+{
+  return vldCrateGSetClockSource(&vldDefaultCrate, clkSrc);
+}
+
+/**
+ * @brief Get the clock source
+ * @details Get the clock source for the specified VLD modlue
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[out] clkSrc clkSrc `[0,1]` Selected Clock Source
+ *       clkSrc | desc
+ *             -|-
+ *         0    | Onboard Oscillator
+ *         1    | External LEMO connector input
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateGetClockSource(vldCrate *crate, int32_t id, uint32_t *clkSrc)
+{
+  VSTATS(vldGetClockSource, id);
+  CHECKID(id);
+
+  VSLOCK_RD(id);
+  *clkSrc = vldCacheRead(crate, id, &crate->mod[id].VLDp->clockSrc) & VLD_CLOCK_MASK;
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateGetClockSource, for the default crate
+ */
+int32_t
+vldGetClockSource(int32_t id, uint32_t *clkSrc)
+{
+  return vldCrateGetClockSource(&vldDefaultCrate, id, clkSrc);
+}
+
+/**
+ * @brief Control the bleach current setting
+ * @details Control the beach current setting for the specified slot ID and connector
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[in] connector `[0,4]` Connector ID
+ * @param[in] lochanEnableMask `[0,0x3FFFF]` Enable mask for the lower 18 channels.
+ * @param[in] hichanEnableMask `[0,0x3FFFF]` Enable mask for the upper 18 channels.
+ * @param[in] ctrlLDO `[0,7]` Bleach current setting
+ * @param[in] enableLDO `[0,1]` Disable (0) / Enable (1) LDO Regulator
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateLEDCalibration(vldCrate *crate, int32_t id, uint32_t connector,
+		       uint32_t lochanEnableMask, uint32_t hichanEnableMask,
+		       uint32_t ctrlLDO, uint32_t enableLDO)
+{
+  uint32_t rval = 0;
+  VSTATS(vldLEDCalibration, id);
+  CHECKID(id);
+
+  if(connector > 4)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, id, "Invalid connector (%d).",
+	     connector);
+      return ERROR;
+    }
+
+  VLD_CHECK_FIELD(ledLow, CHANNELS, lochanEnableMask, "lochanEnableMask");
+  VLD_CHECK_FIELD(ledHigh, CHANNELS, hichanEnableMask, "hichanEnableMask");
+  VLD_CHECK_FIELD(ledLow, BLEACH_CTRL, ctrlLDO, "ctrlLDO");
+
+  enableLDO = enableLDO ? (LED_CONTROL_BLEACH_REG_ENABLE | LED_CONTROL_BLEACH_ENABLE) : 0;
+
+  VSLOCK_WR(id);
+  /* Set enable mask for channels #19 - #36 */
+  vldCacheWrite(crate, id, &crate->mod[id].VLDp->output[connector].high,
+		vldEncode_ledHigh_CHANNELS(hichanEnableMask));
+
+  /* Set enable mask for channels #1 - #18, LDO control, and bleaching enable */
+  vldCacheWrite(crate, id, &crate->mod[id].VLDp->output[connector].low_ctrl,
+		vldEncode_ledLow_CHANNELS(lochanEnableMask) |
+		vldEncode_ledLow_BLEACH_CTRL(ctrlLDO) | enableLDO);
+
+
+  /* Not sure if I set bit 0 or the firmware does.. and reports it back */
+  VSUNLOCK(id);
+  return OK;
+}
+
+/**
+ * @brief vldCrateLEDCalibration, for the default crate
+ */
+int32_t
+vldLEDCalibration(int32_t id, uint32_t connector,
+		  uint32_t lochanEnableMask, uint32_t hichanEnableMask,
+		  uint32_t ctrlLDO, uint32_t enableLDO)
+{
+  return vldCrateLEDCalibration(&vldDefaultCrate, id, connector, lochanEnableMask, hichanEnableMask, ctrlLDO, enableLDO);
+}
+
+/**
+ * @brief Get the bleach current setting
+ * @details Get the channel enable masks and bleach current setting of the
+ * specified slot ID and connector
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[in] connector `[0,4]` Connector ID
+ * @param[out] lochanEnableMask Enable mask for the lower 18 channels.
+ * @param[out] hichanEnableMask Enable mask for the upper 18 channels.
+ * @param[out] ctrlLDO Bleach current setting
+ * @param[out] enableLDO Disabled (0) / Enabled (1) LDO Regulator
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateGetLEDCalibration(vldCrate *crate, int32_t id, uint32_t connector,
+			  uint32_t *lochanEnableMask, uint32_t *hichanEnableMask,
+			  uint32_t *ctrlLDO, uint32_t *enableLDO)
+{
+  uint32_t low = 0, high = 0;
+  VSTATS(vldGetLEDCalibration, id);
+  CHECKID(id);
+
+  if(connector > 4)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, id, "Invalid connector (%d).",
+	     connector);
+      return ERROR;
+    }
+
+  VSLOCK_RD(id);
+  high = vldCacheRead(crate, id, &crate->mod[id].VLDp->output[connector].high);
+  low = vldCacheRead(crate, id, &crate->mod[id].VLDp->output[connector].low_ctrl);
+  VSUNLOCK(id);
+
+  *lochanEnableMask = vldDecode_ledLow_CHANNELS(low);
+  *hichanEnableMask = vldDecode_ledHigh_CHANNELS(high);
+  *ctrlLDO = vldDecode_ledLow_BLEACH_CTRL(low);
+  *enableLDO = vldDecode_ledLow_BLEACH_REG_ENABLE(low) &&
+    ((low & LED_CONTROL_BLEACH_ENABLE_MASK) == LED_CONTROL_BLEACH_ENABLE);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateGetLEDCalibration, for the default crate
+ */
+int32_t
+vldGetLEDCalibration(int32_t id, uint32_t connector,
+		     uint32_t *lochanEnableMask, uint32_t *hichanEnableMask,
+		     uint32_t *ctrlLDO, uint32_t *enableLDO)
+{
+  return vldCrateGetLEDCalibration(&vldDefaultCrate, id, connector, lochanEnableMask,
+				   hichanEnableMask, ctrlLDO, enableLDO);
+}
+
+/**
+ * @brief Set the bleaching timer
+ * @details Set the bleaching timer for the specified module
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ *
+ * @param[in] timer [0, 0x0FFFFFFF] Bleaching time.  If 0, keep the
+ * currently stored value.  Otherwise set the tmie in units of `20ns * 1024 * 1024`
+ *
+ * @param[in] enable `[0,1]` Disable (0) / Enable (1) bleaching timer
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateSetBleachTime(vldCrate *crate, int32_t id, uint32_t timer, uint32_t enable)
+{
+  uint32_t wval = 0;
+  VSTATS(vldSetBleachTime, id);
+  CHECKID(id);
+
+  if(!vldValid_bleachTime_TIMER(timer))
+    {
+      vldLog(VLD_LOG_WARN, VLD_ERR_INVALID_ARG, id,
+	     "Invalid Bleach time %u (0x%x).  Setting to Max (0x%x)",
+	     timer, timer, VLD_FIELD_MAX(bleachTime, TIMER));
+      timer = VLD_FIELD_MAX(bleachTime, TIMER);
+    }
+
+  enable = enable ? VLD_BLEACHTIME_ENABLE : 0;
+
+  VSLOCK_WR(id);
+  if(timer == 0)
+    timer = vldDecode_bleachTime_TIMER(vldCacheRead(crate, id, &crate->mod[id].VLDp->bleachTime));
+
+  wval = timer | enable;
+
+  /*
+    "just want to make sure that the next write (data 0xB.....) will generate a rising edge"
+   */
+  if(enable)
+    vldCacheWrite(crate, id, &crate->mod[id].VLDp->bleachTime, 0);
+
+  vldCacheWrite(crate, id, &crate->mod[id].VLDp->bleachTime, wval);
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateSetBleachTime, for the default crate
+ */
+int32_t
+vldSetBleachTime(int32_t id, uint32_t timer, uint32_t enable)
+{
+  return vldCrateSetBleachTime(&vldDefaultCrate, id, timer, enable);
+}
+
+/**
+ * @brief Get the status of the bleaching timer
+ * @details Get the status of the bleaching timer for the specified module
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ *
+ * @param[out] timer Timer value, units of `20ns * 1024 * 1024`
+ * @param[out] enable Timer enabled status
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateGetBleachTime(vldCrate *crate, int32_t id, uint32_t *timer, uint32_t *enable)
+{
+  uint32_t rval = 0;
+  VSTATS(vldGetBleachTime, id);
+  CHECKID(id);
+
+  VSLOCK_RD(id);
+  rval = vldCacheRead(crate, id, &crate->mod[id].VLDp->bleachTime);
+
+  *timer = vldDecode_bleachTime_TIMER(rval);
+
+  *enable = ((rval & VLD_BLEACHTIME_ENABLE_MASK) == VLD_BLEACHTIME_ENABLE );
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateGetBleachTime, for the default crate
+ */
+int32_t
+vldGetBleachTime(int32_t id, uint32_t *timer, uint32_t *enable)
+{
+  return vldCrateGetBleachTime(&vldDefaultCrate, id, timer, enable);
+}
+
+/**
+ * @brief Pulse Shape loading routine
+ * @details Load a pulse shape into the specified module
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[in] dac_samples `[0, 0x7F]` Address of Array of DAC samples
+ * (2ns) to load. For each sample:
+ *      bits | desc
+ *          -|-
+ *      0:5  | DAC value
+ *      6    | a base line setting for the DAC
+ *
+ * @param[in] nsamples `[0, 2048]` Number of samples in `dac_samples`
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateLoadPulse(vldCrate *crate, int32_t id, uint8_t *dac_samples, uint32_t nsamples)
+{
+  uint32_t isample = 0, ibyte = 0, wval = 0;
+  VSTATS(vldLoadPulse, id);
+  CHECKID(id);
+
+  VSLOCK_WR(id);
+  /* loop through and write 4 byte values out of the 1 byte samples */
+  while(isample < nsamples)
+    {
+      ibyte = (isample % 4);
+      wval |= (dac_samples[isample]) << (ibyte*8);
+
+      /* write if on the last byte of wval, or the last byte of array */
+      if((ibyte == 3) || (isample == (nsamples - 1)))
+	{
+	  vldWrite32(&crate->mod[id].VLDp->pulseLoad, wval);
+	  wval = 0; // clear for next samples */
+	}
+      isample++;
+    }
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateLoadPulse, for the default crate
+ */
+int32_t
+vldLoadPulse(int32_t id, uint8_t *dac_samples, uint32_t nsamples)
+{
+  return vldCrateLoadPulse(&vldDefaultCrate, id, dac_samples, nsamples);
+}
+
+/**
+ * @brief 32bit Pulse Shape loading routine
+ * @details Load a 32bit pulse shape into the specified module.  Each
+ * index, for this routine, represents 4 samples beginning with the
+ * LSB.
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[in] dac_samples Address of Array of 32bit DAC samples
+ * @param[in] nsamples number of 32bit values to write
+ * @return Description
+ */
+int32_t
+vldCrateLoadPulse32(vldCrate *crate, int32_t id, uint32_t *dac_samples, uint32_t nsamples)
+{
+  uint32_t isample = 0, wval = 0;
+  VSTATS(vldLoadPulse32, id);
+  CHECKID(id);
+
+  VSLOCK_WR(id);
+  /* loop through and write 4 byte values out of the 1 byte samples */
+  while(isample < nsamples)
+    {
+      wval = dac_samples[isample];
+      vldWrite32(&crate->mod[id].VLDp->pulseLoad, wval);
+      isample++;
+    }
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateLoadPulse32, for the default crate
+ */
+int32_t
+vldLoadPulse32(int32_t id, uint32_t *dac_samples, uint32_t nsamples)
+{
+  return vldCrateLoadPulse32(&vldDefaultCrate, id, dac_samples, nsamples);
+}
+
+/**
+ * @brief Set the calibration pulse width
+ * @details Set the calibration pulse width of the specified module
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[in] width `[0,1023]` Calibration pulse width in units of `4ns`
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateSetCalibrationPulseWidth(vldCrate *crate, int32_t id, uint32_t width)
+{
+  VSTATS(vldSetCalibrationPulseWidth, id);
+  CHECKID(id);
+
+  VLD_CHECK_FIELD(calibrationWidth, WIDTH, width, "Calibration Pulse Width");
+
+  VSLOCK_WR(id);
+  vldCacheWrite(crate, id, &crate->mod[id].VLDp->calibrationWidth,
+		vldEncode_calibrationWidth_WIDTH(width));
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateSetCalibrationPulseWidth, for the default crate
+ */
+int32_t
+vldSetCalibrationPulseWidth(int32_t id, uint32_t width)
+{
+  return vldCrateSetCalibrationPulseWidth(&vldDefaultCrate, id, width);
+}
+
+/**
+ * @brief Get the calibration pulse width
+ * @details Get the calibration pulse width of the specified module
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[out] width Calibration pulse width in units of `4ns`
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateGetCalibrationPulseWidth(vldCrate *crate, int32_t id, uint32_t *width)
+{
+  VSTATS(vldGetCalibrationPulseWidth, id);
+  CHECKID(id);
+
+  VSLOCK_RD(id);
+  *width = vldDecode_calibrationWidth_WIDTH(vldCacheRead(crate, id, &crate->mod[id].VLDp->calibrationWidth));
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateGetCalibrationPulseWidth, for the default crate
+ */
+int32_t
+vldGetCalibrationPulseWidth(int32_t id, uint32_t *width)
+{
+  return vldCrateGetCalibrationPulseWidth(&vldDefaultCrate, id, width);
+}
+
+/**
+ * @brief Set the analog switch control
+ * @details Set the analog switch control parameters for the specified module
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[in] enableDelay `[0,255]` Switch Control delay, in units of 4ns
+ * @param[in] enableWidth `[0,127]` Switch Control width, in units of 4ns.  If 0, `width = infinite`.
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateSetAnalogSwitchControl(vldCrate *crate, int32_t id, uint32_t enableDelay, uint32_t enableWidth)
+{
+  VSTATS(vldSetAnalogSwitchControl, id);
+  CHECKID(id);
+
+  VLD_CHECK_FIELD(analogCtrl, DELAY, enableDelay, "enableDelay");
+  VLD_CHECK_FIELD(analogCtrl, WIDTH, enableWidth, "enableWidth");
+
+  VSLOCK_WR(id);
+  vldCacheWrite(crate, id, &crate->mod[id].VLDp->analogCtrl,
+		vldEncode_analogCtrl_DELAY(enableDelay) | vldEncode_analogCtrl_WIDTH(enableWidth));
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateSetAnalogSwitchControl, for the default crate
+ */
+int32_t
+vldSetAnalogSwitchControl(int32_t id, uint32_t enableDelay, uint32_t enableWidth)
+{
+  return vldCrateSetAnalogSwitchControl(&vldDefaultCrate, id, enableDelay, enableWidth);
+}
+
+/**
+ * @brief Get the analog switch control
+ * @details Get the analog switch control parameters for the specified module
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[out] enableDelay Switch Control delay, in units of 4ns
+ * @param[out] enableWidth Switch Control width, in units of 4ns.  If 0, `width = infinite`.
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateGetAnalogSwitchControl(vldCrate *crate, int32_t id, uint32_t *enableDelay, uint32_t *enableWidth)
+{
+  uint32_t rval = 0;
+  VSTATS(vldGetAnalogSwitchControl, id);
+  CHECKID(id);
+
+  VSLOCK_RD(id);
+  rval = vldCacheRead(crate, id, &crate->mod[id].VLDp->analogCtrl);
+
+  *enableDelay = vldDecode_analogCtrl_DELAY(rval);
+  *enableWidth = vldDecode_analogCtrl_WIDTH(rval);
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateGetAnalogSwitchControl, for the default crate
+ */
+int32_t
+vldGetAnalogSwitchControl(int32_t id, uint32_t *enableDelay, uint32_t *enableWidth)
+{
+  return vldCrateGetAnalogSwitchControl(&vldDefaultCrate, id, enableDelay, enableWidth);
+}
+
+/**
+ * @brief Set the parameters of internal random pulser
+ * @details Set the parameters of internal random pulser for the specified module
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[in] prescale `[0,7]` Random Pulser Rate prescale. Rate is determined by:
+ *      rate ~ (700 kHz) / (2 ** prescale)
+ *      e.g. prescale = 5, rate ~ 20 kHz
+ * @param[in] enable `[0,1]` Disable (0) / Enable (1) internal random pulser
+ * @return Description
+ */
+int32_t
+vldCrateSetRandomPulser(vldCrate *crate, int32_t id, uint32_t prescale, uint32_t enable)
+{
+  VSTATS(vldSetRandomPulser, id);
+  CHECKID(id);
+
+  VLD_CHECK_FIELD(randomTrig, PRESCALE, prescale, "prescale");
+
+  enable = vldEncode_randomTrig_ENABLE(enable ? 1 : 0);
+
+  VSLOCK_WR(id);
+  if(prescale == 0)
+    prescale = vldDecode_randomTrig_PRESCALE(vldCacheRead(crate, id, &crate->mod[id].VLDp->randomTrig));
+
+  vldCacheWrite(crate, id, &crate->mod[id].VLDp->randomTrig,
+		vldEncode_randomTrig_PRESCALE(prescale) | vldEncode_randomTrig_PRESCALE_HI(prescale) | enable);
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateSetRandomPulser, for the default crate
+ */
+int32_t
+vldSetRandomPulser(int32_t id, uint32_t prescale, uint32_t enable)
+{
+  return vldCrateSetRandomPulser(&vldDefaultCrate, id, prescale, enable);
+}
+
+/**
+ * @brief Get the parameters of internal random pulser
+ * @details Get the parameters of internal random pulser for the specified module
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[out] prescale Random Pulser Rate prescale. Rate is determined by:
+ *      rate ~ (700 kHz) / (2 ** prescale)
+ *      e.g. prescale = 5, rate ~ 20 kHz
+ * @param[out] enable Disable (0) / Enable (1) internal random pulser
+ * @return Description
+ */
+int32_t
+vldCrateGetRandomPulser(vldCrate *crate, int32_t id, uint32_t *prescale, uint32_t *enable)
+{
+  uint32_t rval = 0;
+  VSTATS(vldGetRandomPulser, id);
+  CHECKID(id);
+
+  VSLOCK_RD(id);
+  rval = vldCacheRead(crate, id, &crate->mod[id].VLDp->randomTrig);
+
+  *prescale = vldDecode_randomTrig_PRESCALE(rval);
+  *enable = vldDecode_randomTrig_ENABLE(rval);
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateGetRandomPulser, for the default crate
+ */
+int32_t
+vldGetRandomPulser(int32_t id, uint32_t *prescale, uint32_t *enable)
+{
+  return vldCrateGetRandomPulser(&vldDefaultCrate, id, prescale, enable);
+}
+
+
+/**
+ * @brief Set the parameters for the internal periodic pulser
+ * @details Set the parameters for the internal periodic pulser for the specified module
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[in] period `[0,65535]` Pulser Period
+ * @param[in] npulses `[0,65535]` Number of pulses to generate
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateSetPeriodicPulser(vldCrate *crate, int32_t id, uint32_t period, uint32_t npulses)
+{
+  VSTATS(vldSetPeriodicPulser, id);
+  CHECKID(id);
+
+  VLD_CHECK_FIELD(periodicTrig, PERIOD, period, "period");
+
+  if(!vldValid_periodicTrig_NPULSES(npulses))
+    {
+      vldLog(VLD_LOG_WARN, VLD_ERR_INVALID_ARG, id,
+	     "Invalid npulses (%u).  Set to = %u.", npulses, VLD_FIELD_MAX(periodicTrig, NPULSES));
+      npulses = VLD_FIELD_MAX(periodicTrig, NPULSES);
+    }
+
+  VSLOCK_WR(id);
+  if(period == 0)
+    period = vldDecode_periodicTrig_PERIOD(vldCacheRead(crate, id, &crate->mod[id].VLDp->periodicTrig));
+
+  vldCacheWrite(crate, id, &crate->mod[id].VLDp->periodicTrig,
+		vldEncode_periodicTrig_NPULSES(npulses) | vldEncode_periodicTrig_PERIOD(period));
+  VSUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ * @brief vldCrateSetPeriodicPulser, for the default crate
+ */
+int32_t
+vldSetPeriodicPulser(int32_t id, uint32_t period, uint32_t npulses)
+{
+  return vldCrateSetPeriodicPulser(&vldDefaultCrate, id, period, npulses);
+}
+
+/**
+ * @brief Get the parameters for the internal periodic pulser
+ * @details Get the parameters for the internal periodic pulser for the specified module
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[out] period Pulser Period
+ * @param[out] npulses Number of pulses to generate
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateGetPeriodicPulser(vldCrate *crate, int32_t id, uint32_t *period, uint32_t *npulses)
+{
+  uint32_t rval = 0;
+  VSTATS(vldGetPeriodicPulser, id);
+  CHECKID(id);
 
-  if(nVLD==0)
-    {
-      printf("%s: ERROR: Unable to initialize any VLD modules\n",
-	     __func__);
-      return ERROR;
-    }
+  VSLOCK_RD(id);
+  rval = vldCacheRead(crate, id, &crate->mod[id].VLDp->periodicTrig);
 
-  return OK;
+  *period = vldDecode_periodicTrig_PERIOD(rval);
+  *npulses = vldDecode_periodicTrig_NPULSES(rval);
+  VSUNLOCK(id);
 
+  return OK;
 }
 
 /**
- * @brief Return the slot ID
- * @details Given the order of initialization, return the slot ID of the provided index
- * @param[in] index
- * @return slot ID if successful, otherwise ERROR
+ * @brief vldCrateGetPeriodicPulser, for the default crate
  */
 int32_t
-vldSlot(uint32_t index)
+vldGetPeriodicPulser(int32_t id, uint32_t *period, uint32_t *npulses)
 {
-  if(index >= nVLD)
-    {
-      printf("%s: ERROR: Invalid index (%d)\n",
-	     __func__, index);
-      return ERROR;
-    }
-  return vldID[index];
+  return vldCrateGetPeriodicPulser(&vldDefaultCrate, id, period, npulses);
 }
 
+
 /**
- * @brief Return a mask of initialized VLD slotIDs
- * @return a mask of initialized VLD slotIDs
+ * @brief Get the trigger count
+ * @details Get the trigger count from the specified module
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[out] trigCnt Trigger Count
+ * @return If successful, OK.  Otherwise ERROR.
  */
-uint32_t
-vldSlotMask()
+int32_t
+vldCrateGetTriggerCount(vldCrate *crate, int32_t id, uint32_t *trigCnt)
 {
-  int32_t iv=0;
-  uint32_t dmask=0;
+  VSTATS(vldGetTriggerCount, id);
+  CHECKID(id);
 
-  for(iv = 0; iv < nVLD; iv++)
-    {
-      dmask |= (1 << (vldID[iv]));
-    }
+  VSLOCK_RD(id);
+  *trigCnt = vldRead32(&crate->mod[id].VLDp->trigCnt);
+  vldPublish(crate, id, offsetof(vldRegs, trigCnt) >> 2, trigCnt, 1, ~0ULL);
+  VSUNLOCK(id);
 
-  return dmask;
+  return OK;
 }
 
 /**
- * @brief Return the geographic address
- * @details Return the geographic address of the specified module
- * @param[in] id Slot ID
- * @return Geographic address, if successful.  Otherwise ERROR.
+ * @brief vldCrateGetTriggerCount, for the default crate
  */
 int32_t
-vldGetGeoAddress(int id)
+vldGetTriggerCount(int32_t id, uint32_t *trigCnt)
 {
-  int32_t rval = 0;
-  CHECKID(id);
-
-  VLOCK;
-  rval = (vmeRead32(&VLDp[id]->boardID) & VLD_BOARDID_GEOADR_MASK)>>8;
-  VUNLOCK;
-
-  return rval;
+  return vldCrateGetTriggerCount(&vldDefaultCrate, id, trigCnt);
 }
 
 /**
- * @brief Show the settings and status of the initialized VLD
- * @param[in] pFlag unused
+ * @brief Get the trigger count of all initialized modules
+ * @details Get the trigger counts with one vldCrateGReadWindow, in a
+ * single transaction when the backend has chained block reads.
+ * @param[in] crate Crate context
+ * @param[out] trigCnt Trigger count, indexed by slot ID.  At least MAX_VME_SLOTS+1 entries.
+ * @return The number of modules read, if successful.  Otherwise ERROR.
  */
-void
-vldGStatus(int32_t pFlag)
+int32_t
+vldCrateGGetTriggerCount(vldCrate *crate, uint32_t *trigCnt)
 {
-  vldRegs *rb;
-  uint32_t iv, slot;
-
-  rb = (vldRegs *)malloc((MAX_VME_SLOTS + 1) * sizeof(vldRegs));
+  uint32_t data[MAX_VME_SLOTS+1], mask;
+  int32_t id, nslots, islot = 0;
 
-/** \cond PRIVATE */
-#ifndef READVLD
-#define READVLD(_id, _reg)			\
-  rb[_id]._reg = vmeRead32(&VLDp[_id]->_reg);
-#endif
-/** \endcond */
-
-  VLOCK;
-  for(iv = 0; iv < nVLD; iv++)
-    {
-      slot = vldSlot(iv);
-      READVLD(slot, boardID);
-      READVLD(slot, trigDelay);
-      READVLD(slot, trigSrc);
-      READVLD(slot, clockSrc);
-      READVLD(slot, bleachTime);
-      READVLD(slot, calibrationWidth);
-      READVLD(slot, analogCtrl);
-      READVLD(slot, randomTrig);
-      READVLD(slot, periodicTrig);
-      READVLD(slot, trigCnt);
-    }
-  VUNLOCK;
-
-  printf("VLD Module Status Summary\n");
-
-  printf("         Firmware  Trigger Source........................            Clock...\n");
-  printf("Slot     Version   Periodic  Random    Sequence  External            Source\n");
-  printf("--------------------------------------------------------------------------------\n");
-  /* printf("13       0x1234    Enabled   Enabled   Enabled   Enabled             External"); */
+  mask = vldCrateSlotMask(crate);
+  nslots = vldCrateGReadWindow(crate, mask, offsetof(vldRegs, trigCnt), 1, data);
+  if(nslots < 0)
+    return ERROR;
 
-  for(iv = 0; iv < nVLD; iv++)
+  VLD_FOREACH_SLOT(id, mask)
     {
-      slot = vldSlot(iv);
-
-      /* Slot */
-      printf("%2d       ", iv);
-
-      printf("0x%02x      ", vldFWVers[slot]);
-
-      printf("%s  ", (rb[slot].trigSrc & VLD_TRIGSRC_INTERNAL_PERIODIC_ENABLE) ?
-	     "Enabled " : "Disabled");
-
-      printf("%s  ", (rb[slot].trigSrc & VLD_TRIGSRC_INTERNAL_RANDOM_ENABLE) ?
-	     "Enabled " : "Disabled");
-
-      printf("%s  ", (rb[slot].trigSrc & VLD_TRIGSRC_INTERNAL_SEQUENCE_ENABLE) ?
-	     "Enabled " : "Disabled");
-
-      printf("%s            ", (rb[slot].trigSrc & VLD_TRIGSRC_EXTERNAL_ENABLE) ?
-	     "Enabled " : "Disabled");
-
-      printf("%s", (rb[slot].clockSrc & VLD_CLOCK_EXTERNAL) ?
-	     "External" : "Internal");
-
-      printf("\n");
+      if(islot < nslots)
+	trigCnt[id] = data[islot++];
     }
 
-  printf("\n");
-  printf("         Bleach Timer.....   Calibration.....    Analog Switch.....\n");
-  printf("Slot     Time[ms]  Status    Pulse Width[ns]     Delay[ns] Width[ns]\n");
-  printf("--------------------------------------------------------------------------------\n");
-  /* printf("13       123456789 Enabled   4092                1024      508"); */
-
-  for(iv = 0; iv < nVLD; iv++)
-    {
-      slot = vldSlot(iv);
-
-      /* Slot */
-      printf("%2d       ",iv);
-
-      printf("%10u ", (int)
-	     ((rb[slot].bleachTime & VLD_BLEACHTIME_TIMER_MASK) * 20 * 1024 * 1024) / 1000);
-
-      printf("%s  ",
-	     ((rb[slot].bleachTime & VLD_BLEACHTIME_ENABLE_MASK) == VLD_BLEACHTIME_ENABLE) ?
-	     "Enabled " : "Disabled");
-
-      printf("%4d                ",
-	     (rb[slot].calibrationWidth & VLD_CALIBRATIONWIDTH_MASK) * 4);
+  return nslots;
+}
 
-      printf("%4d      ",
-	     (rb[slot].analogCtrl & VLD_ANALOGCTRL_DELAY_MASK) * 4);
+/**
+ * @brief vldCrateGGetTriggerCount, for the default crate
+ */
+int32_t
+vldGGetTriggerCount(uint32_t *trigCnt)
+{
+  return vldCrateGGetTriggerCount(&vldDefaultCrate, trigCnt);
+}
 
-      printf("%3d",
-	     ((rb[slot].analogCtrl & VLD_ANALOGCTRL_WIDTH_MASK) >> 9) * 4);
+/**
+ * @brief Reset based on specified reset bits
+ * @details Reset the specified module based on the specified reset bits
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
+ * @param[in] resetMask Reset Mask
+ *     bit | desc
+ *        -|-
+ *       1 | I2C
+ *       2 | JTAG
+ *       4 | Clock
+ *      10 | MGT
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldCrateResetMask(vldCrate *crate, int32_t id, uint32_t resetMask)
+{
+  VSTATS(vldResetMask, id);
+  CHECKID(id);
 
-      printf("\n");
+  if((resetMask & ~VLD_RESET_MASK) != 0)
+    {
+      vldLog(VLD_LOG_WARN, VLD_ERR_INVALID_ARG, id,
+	     "Of resetMask (0x%x), only these are defined (0x%x)",
+	     resetMask, resetMask & VLD_RESET_MASK);
     }
 
-  printf("\n");
-  printf("         Random Pulser..............   Periodic Pulser............\n");
-  printf("Slot     Prescale  Rate[kHz] Status    Period    npulses\n");
-  printf("--------------------------------------------------------------------------------\n");
-  /* printf("13       7         700000    Enabled   1234.123  12345151"); */
+  VSLOCK_WR(id);
+  vldWrite32(&crate->mod[id].VLDp->reset, resetMask & VLD_RESET_MASK);
 
-  for(iv = 0; iv < nVLD; iv++)
+  /* Soft reset may return the configuration registers to their defaults */
+  if(resetMask & VLD_RESET_SOFT)
     {
-      slot = vldSlot(iv);
-
-      /* Slot */
-      printf("%2d       ", iv);
-
-      printf("%d         ",
-	     (rb[slot].randomTrig & VLD_RANDOMTRIG_PRESCALE_MASK));
-
-      printf("%6d   ",
-	     700000 >> (rb[slot].randomTrig & VLD_RANDOMTRIG_PRESCALE_MASK) );
-
-      printf("%s  ",
-	     (rb[slot].randomTrig & VLD_RANDOMTRIG_ENABLE) ? "Enabled " : "Disabled");
-
-      printf("%7d  ",
-	     120 + (30 * (rb[slot].periodicTrig & VLD_PERIODICTRIG_PERIOD_MASK)>>16));
-
-      printf("%d",
-	     rb[slot].periodicTrig & VLD_PERIODICTRIG_NPULSES_MASK);
-
-      printf("\n");
+      __atomic_store_n(&crate->st->mod[id].shadowValid, 0, __ATOMIC_RELEASE);
+      __atomic_add_fetch(&crate->st->mod[id].resetSeq, 1, __ATOMIC_RELEASE);
     }
+  VSUNLOCK(id);
 
-  if(rb)
-    free(rb);
-
+  return OK;
 }
 
 /**
- * @brief Set the trigger delay and pulse width
+ * @brief vldCrateResetMask, for the default crate
+ */
+int32_t
+vldResetMask(int32_t id, uint32_t resetMask)
+{
+  return vldCrateResetMask(&vldDefaultCrate, id, resetMask);
+}
 
- * @details For the specified slot id, update the trigger delay and
- * pulse width.
- * The output pulse delay is determined by
- *
- *     out_delay [ns] = 1024 * (delaystep) + (delay + 1) * 4 * 4**(delaystep)
- *
- * The output pulse width is determined by
- *
- *     out_width [ns] = (width + 1) * 4
- *
+/**
+ * @brief I2C Reset
+ * @param[in] crate Crate context
  * @param[in] id Slot ID
- * @param[in] delay `[0,127]` Delay value, units determined by delaystep
- * @param[in] delaystep `[0,1]` Delay units
- *     delaystep | value
- *     ----------|-------
- *      0        | 4ns
- *      1        | 16ns
- * @param[in] width `[0, 31]` Width value, units of `4ns`
  * @return If successful, OK.  Otherwise ERROR.
  */
 int32_t
-vldSetTriggerDelayWidth(int32_t id, int32_t delay, int32_t delaystep, int32_t width)
+vldCrateResetI2C(vldCrate *crate, int32_t id)
 {
-  uint32_t wval=0;
+  VSTATS(vldResetI2C, id);
   CHECKID(id);
 
-  if((delay<0) || (delay>0x7F))
-    {
-      printf("%s(%d): ERROR: Invalid delay (%d).  Must be <= %d\n",
-	     __func__, id,delay, 0x7f);
-      return ERROR;
-    }
-  if((width<0) || (width> 0x1F))
-    {
-      printf("%s(%d): ERROR: Invalid width (%d).  Must be <= %d\n",
-	     __func__, id,width, 0x1F);
-    }
-
-  delaystep = (delaystep ? VLD_TRIGDELAY_16NS_STEP_ENABLE : 0);
-
-  VLOCK;
-  wval = (delay) | (delaystep) | (width << 8);
-
-  vmeWrite32(&VLDp[id]->trigDelay, wval);
-  VUNLOCK;
+  VSLOCK_WR(id);
+  vldWrite32(&crate->mod[id].VLDp->reset, VLD_RESET_I2C);
+  VSUNLOCK(id);
 
   return OK;
 }
 
 /**
- * @brief Get the trigger pulse delay and width parameters
- * @details For the specified slot id, return the trigger delay and
- * pulse width parameters.
- * The output pulse delay is determined by
- *
- *     out_delay [ns] = 1024 * (delaystep) + (delay + 1) * 4 * 4**(delaystep)
- *
- * The output pulse width is determined by
- *
- *     out_width [ns] = (width + 1) * 4
- *
+ * @brief vldCrateResetI2C, for the default crate
+ */
+int32_t
+vldResetI2C(int32_t id)
+{
+  return vldCrateResetI2C(&vldDefaultCrate, id);
+}
+
+/**
+ * @brief JTAG Reset
+ * @param[in] crate Crate context
  * @param[in] id Slot ID
- * @param[out] delay Delay value, units determined by delaystep
- * @param[out] delaystep Delay units
- * @param[out] width Width value
  * @return If successful, OK.  Otherwise ERROR.
  */
 int32_t
-vldGetTriggerDelayWidth(int32_t id, int32_t *delay, int32_t *delaystep, int32_t *width)
+vldCrateResetJTAG(vldCrate *crate, int32_t id)
 {
-  uint32_t rval=0;
+  VSTATS(vldResetJTAG, id);
   CHECKID(id);
 
-  VLOCK;
-  rval = vmeRead32(&VLDp[id]->trigDelay);
-
-  *delay = rval & VLD_TRIGDELAY_DELAY_MASK;
-  *delaystep = (rval & VLD_TRIGDELAY_16NS_STEP_ENABLE) ? 1 : 0;
-  *width = (rval & VLD_TRIGDELAY_WIDTH_MASK) >> 8;
-
-  VUNLOCK;
+  VSLOCK_WR(id);
+  vldWrite32(&crate->mod[id].VLDp->reset, VLD_RESET_JTAG);
+  VSUNLOCK(id);
 
   return OK;
 }
 
 /**
- * @brief Set the trigger source mask
- * @details Set the trigger source of the specified VLD using the bits:
- *    bit | trigger source
- *       -|-
- *     0  | internal periodic
- *     1  | internal random
- *     2  | internal sequence
- *     4  | external input
- *
+ * @brief vldCrateResetJTAG, for the default crate
+ */
+int32_t
+vldResetJTAG(int32_t id)
+{
+  return vldCrateResetJTAG(&vldDefaultCrate, id);
+}
+
+/**
+ * @brief Soft Reset
+ * @param[in] crate Crate context
  * @param[in] id Slot ID
- * @param[in] trigSrc trigger source mask
  * @return If successful, OK.  Otherwise ERROR.
  */
 int32_t
-vldSetTriggerSourceMask(int32_t id, uint32_t trigSrc)
+vldCrateSoftReset(vldCrate *crate, int32_t id)
 {
+  VSTATS(vldSoftReset, id);
   CHECKID(id);
 
-  if((trigSrc & ~VLD_TRIGSRC_MASK) != 0)
-    {
-      printf("%s(%d): ERROR: Invalid trigSrc Mask (0x%x).  Allowed bits in mask 0x%x\n",
-	     __func__, id, trigSrc, VLD_TRIGSRC_MASK);
-      return ERROR;
-    }
-
-  VLOCK;
-  vmeWrite32(&VLDp[id]->trigSrc, trigSrc);
-  VUNLOCK;
+  VSLOCK_WR(id);
+  vldWrite32(&crate->mod[id].VLDp->reset, VLD_RESET_SOFT);
+  __atomic_store_n(&crate->st->mod[id].shadowValid, 0, __ATOMIC_RELEASE);
+  __atomic_add_fetch(&crate->st->mod[id].resetSeq, 1, __ATOMIC_RELEASE);
+  VSUNLOCK(id);
 
   return OK;
 }
 
 /**
- * @brief Get the trigger source mask
- * @details Get the trigger source of the specified VLD. Trigger bits are:
- *    bit | trigger source
- *       -|-
- *     0  | internal periodic
- *     1  | internal random
- *     2  | internal sequence
- *     4  | external input
+ * @brief vldCrateSoftReset, for the default crate
+ */
+int32_t
+vldSoftReset(int32_t id)
+{
+  return vldCrateSoftReset(&vldDefaultCrate, id);
+}
+
+/**
+ * @brief Clock DCM Reset
+ * @param[in] crate Crate context
  * @param[in] id Slot ID
- * @param[out] trigSrc Enabled Trigger Source mask
  * @return If successful, OK.  Otherwise ERROR.
  */
 int32_t
-vldGetTriggerSourceMask(int32_t id, uint32_t *trigSrc)
+vldCrateResetClockDCM(vldCrate *crate, int32_t id)
 {
+  VSTATS(vldResetClockDCM, id);
   CHECKID(id);
 
-  VLOCK;
-  *trigSrc = vmeRead32(&VLDp[id]->trigSrc) & VLD_TRIGSRC_MASK;
-  VUNLOCK;
+  VSLOCK_WR(id);
+  vldWrite32(&crate->mod[id].VLDp->reset, VLD_RESET_CLK);
+  VSUNLOCK(id);
 
   return OK;
 }
 
-
 /**
- * @brief Set the clock source
- * @details Set the clock source for the specified VLD modlue
- * @param[in] id Slot ID
- * @param[in] clkSrc `[0,1]` Selected Clock Source
- *       clkSrc | desc
- *             -|-
- *         0    | Onboard Oscillator
- *         1    | External LEMO connector input
+ * @brief vldCrateResetClockDCM, for the default crate
+ */
+int32_t
+vldResetClockDCM(int32_t id)
+{
+  return vldCrateResetClockDCM(&vldDefaultCrate, id);
+}
+
+/**
+ * @brief MGT Reset
+ * @param[in] crate Crate context
+ * @param[in] id Slot ID
  * @return If successful, OK.  Otherwise ERROR.
  */
 int32_t
-vldSetClockSource(int32_t id, uint32_t clkSrc)
+vldCrateResetMGT(vldCrate *crate, int32_t id)
 {
+  VSTATS(vldResetMGT, id);
   CHECKID(id);
 
-  if(clkSrc > 1)
-    {
-      printf("%s(%d): ERROR: Invalid clkSrc (%d)\n",
-	     __func__, id, clkSrc);
-      return ERROR;
-    }
-
-  VLOCK;
-  vmeWrite32(&VLDp[id]->clockSrc, clkSrc);
-  sleep(1);
-  vmeWrite32(&VLDp[id]->reset, VLD_RESET_CLK);
-  VUNLOCK;
+  VSLOCK_WR(id);
+  vldWrite32(&crate->mod[id].VLDp->reset, VLD_RESET_MGT);
+  VSUNLOCK(id);
 
   return OK;
 }
 
 /**
- * @brief Get the clock source
- * @details Get the clock source for the specified VLD modlue
- * @param[in] id Slot ID
- * @param[out] clkSrc clkSrc `[0,1]` Selected Clock Source
- *       clkSrc | desc
- *             -|-
- *         0    | Onboard Oscillator
- *         1    | External LEMO connector input
- * @return If successful, OK.  Otherwise ERROR.
+ * @brief vldCrateResetMGT, for the default crate
  */
 int32_t
-vldGetClockSource(int32_t id, uint32_t *clkSrc)
+vldResetMGT(int32_t id)
+{
+  return vldCrateResetMGT(&vldDefaultCrate, id);
+}
+
+int32_t
+vldCrateHardClockReset(vldCrate *crate, int32_t id)
 {
+  VSTATS(vldHardClockReset, id);
   CHECKID(id);
 
-  VLOCK;
-  *clkSrc = vmeRead32(&VLDp[id]->clockSrc) & VLD_CLOCK_MASK;
-  VUNLOCK;
+  VSLOCK_WR(id);
+  vldWrite32(&crate->mod[id].VLDp->reset, VLD_RESET_HARD_CLK);
+  VSUNLOCK(id);
 
   return OK;
 }
 
 /**
- * @brief Control the bleach current setting
- * @details Control the beach current setting for the specified slot ID and connector
- * @param[in] id Slot ID
- * @param[in] connector `[0,4]` Connector ID
- * @param[in] lochanEnableMask `[0,0x3FFFF]` Enable mask for the lower 18 channels.
- * @param[in] hichanEnableMask `[0,0x3FFFF]` Enable mask for the upper 18 channels.
- * @param[in] ctrlLDO `[0,7]` Bleach current setting
- * @param[in] enableLDO `[0,1]` Disable (0) / Enable (1) LDO Regulator
- * @return If successful, OK.  Otherwise ERROR.
+ * @brief vldCrateHardClockReset, for the default crate
  */
 int32_t
-vldLEDCalibration(int32_t id, uint32_t connector,
-		  uint32_t lochanEnableMask, uint32_t hichanEnableMask,
-		  uint32_t ctrlLDO, uint32_t enableLDO)
+vldHardClockReset(int32_t id)
 {
-  uint32_t rval = 0;
-  CHECKID(id);
+  return vldCrateHardClockReset(&vldDefaultCrate, id);
+}
 
-  if(connector > 4)
+/** \cond PRIVATE */
+/* Group operation, shared by the caller and the worker pool */
+typedef struct vldGJob
+{
+  vldSlotFunction func;
+  void *arg;
+  int32_t slot[MAX_VME_SLOTS+1];
+  int32_t rval[MAX_VME_SLOTS+1];
+  int32_t nslot;
+  int32_t next;            /* next index of slot[] to run */
+  int32_t ndone;
+  struct vldGJob *qnext;
+} vldGJob;
+
+/* Worker pool for group operations, guarded by vldPoolMutex */
+static pthread_mutex_t vldPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t vldPoolWork = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t vldPoolDone = PTHREAD_COND_INITIALIZER;
+static pthread_t vldPoolThread[MAX_VME_SLOTS];
+static int32_t vldPoolNThreads = 0;
+static int32_t vldPoolNWorkers = VLD_G_DEFAULT_WORKERS;
+static int32_t vldPoolShutdown = 0;
+static vldGJob *vldPoolQueue = NULL;
+
+/* Take the next slot index from the job, and dequeue the job when it has no more.
+   Called with vldPoolMutex held */
+static int32_t
+vldPoolTake(vldGJob *job)
+{
+  vldGJob **pjob;
+  int32_t index = job->next++;
+
+  if(job->next >= job->nslot)
     {
-      printf("%s(%d): ERROR: Invalid connector (%d).\n",
-	     __func__, id, connector);
-      return ERROR;
+      for(pjob = &vldPoolQueue; *pjob != NULL; pjob = &(*pjob)->qnext)
+	{
+	  if(*pjob == job)
+	    {
+	      *pjob = job->qnext;
+	      break;
+	    }
+	}
     }
 
-  if(lochanEnableMask > 0x0003FFFF)
+  return index;
+}
+
+/* Run the job for one slot.  Called, and returns, with vldPoolMutex held */
+static void
+vldPoolRun(vldGJob *job, int32_t index)
+{
+  int32_t rval;
+
+  pthread_mutex_unlock(&vldPoolMutex);
+  rval = job->func(job->slot[index], job->arg);
+  pthread_mutex_lock(&vldPoolMutex);
+
+  job->rval[index] = rval;
+  if(++job->ndone == job->nslot)
+    pthread_cond_broadcast(&vldPoolDone);
+}
+
+static void *
+vldPoolWorker(void *arg)
+{
+  vldGJob *job;
+
+  pthread_mutex_lock(&vldPoolMutex);
+  while(1)
     {
-      printf("%s(%d): ERROR: Invalid lochanEnableMask (0x%x).\n",
-	     __func__, id, lochanEnableMask);
-      return ERROR;
+      while((vldPoolQueue == NULL) && (vldPoolShutdown == 0))
+	pthread_cond_wait(&vldPoolWork, &vldPoolMutex);
+
+      if(vldPoolShutdown)
+	break;
+
+      job = vldPoolQueue;
+      vldPoolRun(job, vldPoolTake(job));
     }
+  pthread_mutex_unlock(&vldPoolMutex);
+
+  return NULL;
+}
+
+/* Start the worker threads, if they're not running.  Called with vldPoolMutex held */
+static void
+vldPoolStart()
+{
+  int32_t ithread;
 
-  if(hichanEnableMask > 0x0003FFFF)
+  for(ithread = vldPoolNThreads; ithread < vldPoolNWorkers; ithread++)
     {
-      printf("%s(%d): ERROR: Invalid hichanEnableMask (0x%x).\n",
-	     __func__, id, hichanEnableMask);
-      return ERROR;
+      if(pthread_create(&vldPoolThread[ithread], NULL, vldPoolWorker, NULL) != 0)
+	{
+	  vldLog(VLD_LOG_ERROR, VLD_ERR_SYSTEM, -1, "pthread_create failed");
+	  break;
+	}
+      vldPoolNThreads++;
     }
+}
 
-  if(ctrlLDO > 0x7)
+/* Start the worker threads now, for the allocation-free mode */
+static void
+vldPoolPrestart()
+{
+  pthread_mutex_lock(&vldPoolMutex);
+  vldPoolStart();
+  pthread_mutex_unlock(&vldPoolMutex);
+}
+/* Run a job on the pool and in the calling thread, and wait for it */
+static void
+vldPoolExecute(vldGJob *job)
+{
+  pthread_mutex_lock(&vldPoolMutex);
+  if((vldPoolNWorkers > 0) && (job->nslot > 1))
     {
-      printf("%s(%d): ERROR: Invalid ctrlLDO (0x%x)\n",
-	     __func__, id, ctrlLDO);
-      return ERROR;
+      vldPoolStart();
+      job->qnext = vldPoolQueue;
+      vldPoolQueue = job;
+      pthread_cond_broadcast(&vldPoolWork);
     }
 
-  enableLDO = enableLDO ? (LED_CONTROL_BLEACH_REG_ENABLE | LED_CONTROL_BLEACH_ENABLE) : 0;
+  /* Work on our own job, until there's nothing left to start */
+  while(job->next < job->nslot)
+    vldPoolRun(job, vldPoolTake(job));
 
-  VLOCK;
-  /* Set enable mask for channels #19 - #36 */
-  vmeWrite32(&VLDp[id]->output[connector].high, (hichanEnableMask << 1));
+  while(job->ndone < job->nslot)
+    pthread_cond_wait(&vldPoolDone, &vldPoolMutex);
+  pthread_mutex_unlock(&vldPoolMutex);
+}
 
-  /* Set enable mask for channels #1 - #18, LDO control, and bleaching enable */
-  vmeWrite32(&VLDp[id]->output[connector].low_ctrl,
-	     (lochanEnableMask << 1) | (ctrlLDO << 24) | enableLDO);
+/* Call func(lane, arg) for lanes [0, nlanes), at most MAX_VME_SLOTS+1, on
+   the pool.  For work that is not one call per module */
+static void
+vldPoolLanes(int32_t nlanes, vldSlotFunction func, void *arg)
+{
+  vldGJob job;
 
+  job.func = func;
+  job.arg = arg;
+  job.nslot = 0;
+  job.next = 0;
+  job.ndone = 0;
+  job.qnext = NULL;
 
-  /* Not sure if I set bit 0 or the firmware does.. and reports it back */
-  VUNLOCK;
-  return OK;
+  while((job.nslot < nlanes) && (job.nslot <= MAX_VME_SLOTS))
+    {
+      job.slot[job.nslot] = job.nslot;
+      job.nslot++;
+    }
+
+  vldPoolExecute(&job);
 }
+/** \endcond */
 
 /**
- * @brief Set the bleaching timer
- * @details Set the bleaching timer for the specified module
- * @param[in] id Slot ID
- *
- * @param[in] timer [0, 0x0FFFFFFF] Bleaching time.  If 0, keep the
- * currently stored value.  Otherwise set the tmie in units of `20ns * 1024 * 1024`
- *
- * @param[in] enable `[0,1]` Disable (0) / Enable (1) bleaching timer
+ * @brief Set the number of worker threads for group operations
+ * @details Set the number of threads used by vldGExecute and
+ * vldGExecuteMask, and by the address probes of vldInit and vldRescan,
+ * in addition to the calling thread.  Threads are
+ * started when first needed, or now in the allocation-free mode
+ * (vldSetArena).  If 0, group operations run serially in
+ * the calling thread.
+ * @param[in] nworkers `[0, MAX_VME_SLOTS]` Number of worker threads
  * @return If successful, OK.  Otherwise ERROR.
  */
 int32_t
-vldSetBleachTime(int32_t id, uint32_t timer, uint32_t enable)
+vldGSetWorkers(int32_t nworkers)
 {
-  uint32_t wval = 0;
-  CHECKID(id);
+  int32_t ithread, nthreads;
 
-  if(timer > VLD_BLEACHTIME_TIMER_MASK)
+  if((nworkers < 0) || (nworkers > MAX_VME_SLOTS))
     {
-      printf("%s(%d): WARN: Invalid Bleach time %u (0x%x).  Setting to Max (0x%x)\n",
-	     __func__, id, timer, timer, VLD_BLEACHTIME_TIMER_MASK);
-      timer = VLD_BLEACHTIME_TIMER_MASK;
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid nworkers (%d).  Max = %d",
+	     nworkers, MAX_VME_SLOTS);
+      return ERROR;
     }
 
-  enable = enable ? VLD_BLEACHTIME_ENABLE : 0;
-
-  VLOCK;
-  if(timer == 0)
-    timer = vmeRead32(&VLDp[id]->bleachTime) & VLD_BLEACHTIME_TIMER_MASK;
+  /* Stop the current pool, new threads are started on the next group operation */
+  pthread_mutex_lock(&vldPoolMutex);
+  vldPoolShutdown = 1;
+  pthread_cond_broadcast(&vldPoolWork);
+  nthreads = vldPoolNThreads;
+  pthread_mutex_unlock(&vldPoolMutex);
 
-  wval = timer | enable;
-
-  /*
-    "just want to make sure that the next write (data 0xB.....) will generate a rising edge"
-   */
-  if(enable)
-    vmeWrite32(&VLDp[id]->bleachTime, 0);
+  for(ithread = 0; ithread < nthreads; ithread++)
+    pthread_join(vldPoolThread[ithread], NULL);
 
-  vmeWrite32(&VLDp[id]->bleachTime, wval);
-  VUNLOCK;
+  pthread_mutex_lock(&vldPoolMutex);
+  vldPoolNThreads = 0;
+  vldPoolShutdown = 0;
+  vldPoolNWorkers = nworkers;
+  if(vldArenaBase != NULL)
+    vldPoolStart();
+  pthread_mutex_unlock(&vldPoolMutex);
 
   return OK;
 }
 
 /**
- * @brief Get the status of the bleaching timer
- * @details Get the status of the bleaching timer for the specified module
- * @param[in] id Slot ID
- *
- * @param[out] timer Timer value, units of `20ns * 1024 * 1024`
- * @param[out] enable Timer enabled status
- * @return If successful, OK.  Otherwise ERROR.
+ * @brief Run a routine for each of the specified VLDs, in parallel
+ * @details Call func(id, arg) for each initialized VLD in slotMask.  The
+ * calls are spread over the worker pool and the calling thread.  Returns
+ * when every call has returned.  func may itself call group operations.
+ * @param[in] crate Crate context
+ * @param[in] slotMask Mask of slot IDs.  Slots that are not initialized are ignored.
+ * @param[in] func Routine to call for each slot
+ * @param[in] arg Argument passed to each call of func
+ * @param[out] results If not NULL, the value returned by func for each slot, index = slotID.
+ * Elements for slots not in the mask are not modified.
+ * @return OK if every call of func returned OK, otherwise ERROR.
  */
 int32_t
-vldGetBleachTime(int32_t id, uint32_t *timer, uint32_t *enable)
+vldCrateGExecuteMask(vldCrate *crate, uint32_t slotMask, vldSlotFunction func, void *arg, int32_t *results)
 {
-  uint32_t rval = 0;
-  CHECKID(id);
+  vldGJob job;
+  int32_t id, index, rval = OK;
+  VSTATS(vldGExecuteMask, 0);
 
-  VLOCK;
-  rval = vmeRead32(&VLDp[id]->bleachTime);
+  if(func == NULL)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid function pointer");
+      return ERROR;
+    }
 
-  *timer = rval & VLD_BLEACHTIME_TIMER_MASK;
+  job.func = func;
+  job.arg = arg;
+  job.nslot = 0;
+  job.next = 0;
+  job.ndone = 0;
+  job.qnext = NULL;
 
-  *enable = ((rval & VLD_BLEACHTIME_ENABLE_MASK) == VLD_BLEACHTIME_ENABLE );
-  VUNLOCK;
+  slotMask &= vldCrateSlotMask(crate);
+  VLD_FOREACH_SLOT(id, slotMask)
+    job.slot[job.nslot++] = id;
 
-  return OK;
+  if(job.nslot == 0)
+    return OK;
+
+  vldPoolExecute(&job);
+
+  for(index = 0; index < job.nslot; index++)
+    {
+      if(results)
+	results[job.slot[index]] = job.rval[index];
+      if(job.rval[index] != OK)
+	rval = ERROR;
+    }
+
+  return rval;
 }
 
 /**
- * @brief Pulse Shape loading routine
- * @details Load a pulse shape into the specified module
- * @param[in] id Slot ID
- * @param[in] dac_samples `[0, 0x7F]` Address of Array of DAC samples
- * (2ns) to load. For each sample:
- *      bits | desc
- *          -|-
- *      0:5  | DAC value
- *      6    | a base line setting for the DAC
- *
- * @param[in] nsamples `[0, 2048]` Number of samples in `dac_samples`
- * @return If successful, OK.  Otherwise ERROR.
+ * @brief vldCrateGExecuteMask, for the default crate
  */
 int32_t
-vldLoadPulse(int32_t id, uint8_t *dac_samples, uint32_t nsamples)
+vldGExecuteMask(uint32_t slotMask, vldSlotFunction func, void *arg, int32_t *results)
 {
-  uint32_t isample = 0, ibyte = 0, wval = 0;
-  CHECKID(id);
+  return vldCrateGExecuteMask(&vldDefaultCrate, slotMask, func, arg, results);
+}
 
-  VLOCK;
-  /* loop through and write 4 byte values out of the 1 byte samples */
-  while(isample < nsamples)
-    {
-      ibyte = (isample % 4);
-      wval |= (dac_samples[isample]) << (ibyte*8);
+/**
+ * @brief Run a routine for each initialized VLD, in parallel
+ * @details Call func(id, arg) for each initialized VLD.  See vldGExecuteMask.
+ * @param[in] crate Crate context
+ * @param[in] func Routine to call for each slot
+ * @param[in] arg Argument passed to each call of func
+ * @param[out] results If not NULL, the value returned by func for each slot, index = slotID
+ * @return OK if every call of func returned OK, otherwise ERROR.
+ */
+int32_t
+vldCrateGExecute(vldCrate *crate, vldSlotFunction func, void *arg, int32_t *results)
+{
+  return vldCrateGExecuteMask(crate, vldCrateSlotMask(crate), func, arg, results);
+}
 
-      /* write if on the last byte of wval, or the last byte of array */
-      if((ibyte == 3) || (isample == (nsamples - 1)))
-	{
-	  vmeWrite32(&VLDp[id]->pulseLoad, wval);
-	  wval = 0; // clear for next samples */
-	}
-      isample++;
+/**
+ * @brief vldCrateGExecute, for the default crate
+ */
+int32_t
+vldGExecute(vldSlotFunction func, void *arg, int32_t *results)
+{
+  return vldCrateGExecute(&vldDefaultCrate, func, arg, results);
+}
+
+/** \cond PRIVATE */
+typedef struct
+{
+  vldCrate *crate;
+  const vldBringUpConfig *config;
+  vldBringUpReport *report;
+} vldBringUpJob;
+
+static inline uint64_t
+vldBringUpNow()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Configure a module: load its pulse shape, and commit its registers at once */
+static int32_t
+vldBringUpModule(int32_t id, void *arg)
+{
+  vldBringUpJob *job = (vldBringUpJob *)arg;
+  vldCrate *crate = job->crate;
+  const vldBringUpConfig *c = job->config;
+  uint64_t start = vldBringUpNow();
+  int32_t rval = OK;
+  uint32_t iled;
+
+  if((c->stages & VLD_BRINGUP_PULSE) &&
+     (vldCrateLoadPulse32(crate, id, (uint32_t *)c->pulse, c->npulse) != OK))
+    rval = ERROR;
+
+  if(vldCrateConfigBegin(crate, id) != OK)
+    return ERROR;
+
+  if(c->stages & VLD_BRINGUP_TRIGDELAY)
+    rval |= vldCrateSetTriggerDelayWidth(crate, id, c->trigDelay, c->trigDelayStep, c->trigWidth);
+
+  if(c->stages & VLD_BRINGUP_LED)
+    {
+      for(iled = 0; iled < c->nled; iled++)
+	rval |= vldCrateLEDCalibration(crate, id, c->led[iled].connector,
+				       c->led[iled].lochanEnableMask,
+				       c->led[iled].hichanEnableMask,
+				       c->led[iled].ctrlLDO, c->led[iled].enableLDO);
     }
-  VUNLOCK;
 
-  return OK;
+  if(c->stages & VLD_BRINGUP_BLEACH)
+    rval |= vldCrateSetBleachTime(crate, id, c->bleachTimer, c->bleachEnable);
+
+  if(c->stages & VLD_BRINGUP_RANDOM)
+    rval |= vldCrateSetRandomPulser(crate, id, c->randomPrescale, c->randomEnable);
+
+  if(c->stages & VLD_BRINGUP_PERIODIC)
+    rval |= vldCrateSetPeriodicPulser(crate, id, c->periodicPeriod, c->periodicNpulses);
+
+  if(rval != OK)
+    vldCrateConfigAbort(crate, id);
+  else
+    rval = vldCrateConfigCommit(crate, id);
+
+  job->report->configNs[id] = vldBringUpNow() - start;
+
+  return (rval == OK) ? OK : ERROR;
+}
+
+/* Enable the trigger sources of a module */
+static int32_t
+vldBringUpEnable(int32_t id, void *arg)
+{
+  vldBringUpJob *job = (vldBringUpJob *)arg;
+
+  return vldCrateSetTriggerSourceMask(job->crate, id, job->config->trigSrc);
 }
+/** \endcond */
 
 /**
- * @brief 32bit Pulse Shape loading routine
- * @details Load a 32bit pulse shape into the specified module.  Each
- * index, for this routine, represents 4 samples beginning with the
- * LSB.
- * @param[in] id Slot ID
- * @param[in] dac_samples Address of Array of 32bit DAC samples
- * @param[in] nsamples number of 32bit values to write
- * @return Description
+ * @brief Bring up the modules of a crate
+ * @details Initialize the crate, and configure each module, with the
+ * stages selected in config->stages.  The stages are pipelined across
+ * the modules:
+ *
+ *   - vldInit probes every address at once
+ *   - The clock source of every module is written, and one clock settle
+ *     interval runs for all of them, before each module's clock DCM reset
+ *   - Then each module loads its pulse shape and commits its
+ *     configuration registers (trigger delay, LED calibration,
+ *     bleaching, pulsers), on the group workers, all at once
+ *   - Last, the trigger sources are enabled
+ *
+ * The time of each phase, and of each module's configuration, is
+ * returned in report.  A module that fails a stage is left in
+ * report->failMask, and its trigger sources are not enabled.  A module
+ * whose clock switch failed is not configured either.
+ * @param[in] crate Crate context
+ * @param[in] config Stages, and their settings
+ * @param[out] report Timing and outcome.  May be NULL
+ * @return If every module was brought up, OK.  Otherwise ERROR.
  */
 int32_t
-vldLoadPulse32(int32_t id, uint32_t *dac_samples, uint32_t nsamples)
+vldCrateBringUp(vldCrate *crate, const vldBringUpConfig *config, vldBringUpReport *report)
 {
-  uint32_t isample = 0, wval = 0;
-  CHECKID(id);
+  vldBringUpReport localReport;
+  vldBringUpJob job;
+  vldClockSwitch cs;
+  int32_t results[MAX_VME_SLOTS+1];
+  int32_t id, clockStarted = 0;
+  uint32_t configMask;
+  uint64_t start, t0;
+
+  if((config == NULL) || ((config->stages & VLD_BRINGUP_PULSE) && (config->pulse == NULL)) ||
+     (config->nled > VLD_BRINGUP_MAX_LED))
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid bring-up configuration");
+      return ERROR;
+    }
 
-  VLOCK;
-  /* loop through and write 4 byte values out of the 1 byte samples */
-  while(isample < nsamples)
+  if(report == NULL)
+    report = &localReport;
+  memset(report, 0, sizeof(vldBringUpReport));
+  job.crate = crate;
+  job.config = config;
+  job.report = report;
+  start = t0 = vldBringUpNow();
+
+  if(config->stages & VLD_BRINGUP_INIT)
     {
-      wval = dac_samples[isample];
-      vmeWrite32(&VLDp[id]->pulseLoad, wval);
-      isample++;
+      if(vldCrateInit(crate, config->vmeAddr, config->vmeIncr, config->nincr,
+		      config->iFlag) != OK)
+	return ERROR;
+    }
+  report->phaseNs[VLD_BRINGUP_PHASE_INIT] = vldBringUpNow() - t0;
+
+  report->slotMask = vldCrateSlotMask(crate);
+  if(config->slotMask)
+    report->slotMask &= config->slotMask;
+  if(report->slotMask == 0)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_NOT_INITIALIZED, -1, "No modules to bring up");
+      return ERROR;
+    }
+
+  t0 = vldBringUpNow();
+  if(config->stages & VLD_BRINGUP_CLOCK)
+    {
+      if(vldCrateSetClockSourceAsync(crate, &cs, report->slotMask, config->clkSrc,
+				     NULL, NULL) != OK)
+	return ERROR;
+      clockStarted = 1;
+    }
+  report->phaseNs[VLD_BRINGUP_PHASE_CLOCK] = vldBringUpNow() - t0;
+
+  /* A module isn't written while its clock switches: the registers and the
+     pulse FIFO aren't known to survive its DCM reset */
+  t0 = vldBringUpNow();
+  if(clockStarted && (vldClockSwitchWait(&cs) != OK))
+    report->failMask |= report->slotMask & ~vldClockSwitchDoneMask(&cs);
+  report->phaseNs[VLD_BRINGUP_PHASE_SETTLE] = vldBringUpNow() - t0;
+
+  /* Modules whose clock switch failed are not configured */
+  t0 = vldBringUpNow();
+  configMask = report->slotMask & ~report->failMask;
+  if(config->stages & (VLD_BRINGUP_PULSE | VLD_BRINGUP_TRIGDELAY | VLD_BRINGUP_LED |
+		       VLD_BRINGUP_BLEACH | VLD_BRINGUP_RANDOM | VLD_BRINGUP_PERIODIC))
+    {
+      vldCrateGExecuteMask(crate, configMask, vldBringUpModule, &job, results);
+      VLD_FOREACH_SLOT(id, configMask)
+	{
+	  if(results[id] != OK)
+	    report->failMask |= (1 << id);
+	}
+    }
+  report->phaseNs[VLD_BRINGUP_PHASE_CONFIG] = vldBringUpNow() - t0;
+
+  t0 = vldBringUpNow();
+  if(config->stages & VLD_BRINGUP_TRIGSRC)
+    {
+      configMask = report->slotMask & ~report->failMask;
+      vldCrateGExecuteMask(crate, configMask, vldBringUpEnable, &job, results);
+      VLD_FOREACH_SLOT(id, configMask)
+	{
+	  if(results[id] != OK)
+	    report->failMask |= (1 << id);
+	}
+    }
+  report->phaseNs[VLD_BRINGUP_PHASE_ENABLE] = vldBringUpNow() - t0;
+  report->totalNs = vldBringUpNow() - start;
+
+  vldLog(VLD_LOG_INFO, VLD_ERR_NONE, -1,
+	 "Brought up 0x%06x in %.1f ms (init %.1f, clock %.1f, settle %.1f, config %.1f, enable %.1f)",
+	 report->slotMask & ~report->failMask, report->totalNs * 1e-6,
+	 report->phaseNs[VLD_BRINGUP_PHASE_INIT] * 1e-6,
+	 report->phaseNs[VLD_BRINGUP_PHASE_CLOCK] * 1e-6,
+	 report->phaseNs[VLD_BRINGUP_PHASE_SETTLE] * 1e-6,
+	 report->phaseNs[VLD_BRINGUP_PHASE_CONFIG] * 1e-6,
+	 report->phaseNs[VLD_BRINGUP_PHASE_ENABLE] * 1e-6);
+
+  if(report->failMask)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_BAD_STATE, -1, "Bring-up failed for 0x%06x",
+	     report->failMask);
+      return ERROR;
     }
-  VUNLOCK;
 
   return OK;
 }
 
 /**
- * @brief Set the calibration pulse width
- * @details Set the calibration pulse width of the specified module
- * @param[in] id Slot ID
- * @param[in] width `[0,1023]` Calibration pulse width in units of `4ns`
- * @return If successful, OK.  Otherwise ERROR.
+ * @brief vldCrateBringUp, for the default crate
  */
 int32_t
-vldSetCalibrationPulseWidth(int32_t id, uint32_t width)
+vldBringUp(const vldBringUpConfig *config, vldBringUpReport *report)
+{
+  return vldCrateBringUp(&vldDefaultCrate, config, report);
+}
+
+
+/** \cond PRIVATE */
+/* Publish a sample in the ring of the specified slot.  resetSeq is that
+   of the module when raw was read.  Only called by the sampler thread */
+static void
+vldSamplerPush(vldCrate *crate, int32_t id, uint64_t timestamp, uint32_t raw,
+	       uint32_t resetSeq)
 {
-  CHECKID(id);
+  vldSampleRing *ring = &crate->mod[id].sampler;
+  uint64_t head = ring->head;
+  uint32_t ientry = head & (VLD_SAMPLER_RING_SIZE - 1);
 
-  if(width > VLD_CALIBRATIONWIDTH_MASK)
+  /* The module was reset or replaced: trigCnt starts again, it did not wrap */
+  if(resetSeq != ring->resetSeq)
     {
-      printf("%s(%d): ERROR: Invalid Calibration Pulse Width (0x%x).  Max = 0x%x\n",
-	     __func__, id, width, VLD_CALIBRATIONWIDTH_MASK);
-      return ERROR;
+      ring->lastRaw = 0;
+      ring->resetSeq = resetSeq;
     }
 
-  VLOCK;
-  vmeWrite32(&VLDp[id]->calibrationWidth, width);
-  VUNLOCK;
+  if((head > 0) && (raw < ring->lastRaw))
+    ring->high += (1ULL << 32);  /* trigCnt wrapped */
+  ring->lastRaw = raw;
 
-  return OK;
+  __atomic_store_n(&ring->entry[ientry].seq, ring->entry[ientry].seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&ring->entry[ientry].index, head, __ATOMIC_RELAXED);
+  __atomic_store_n(&ring->entry[ientry].sample.timestamp, timestamp, __ATOMIC_RELAXED);
+  __atomic_store_n(&ring->entry[ientry].sample.count, ring->high | raw, __ATOMIC_RELAXED);
+  __atomic_store_n(&ring->entry[ientry].seq, ring->entry[ientry].seq + 1, __ATOMIC_RELEASE);
+
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
 }
 
-/**
- * @brief Get the calibration pulse width
- * @details Get the calibration pulse width of the specified module
- * @param[in] id Slot ID
- * @param[out] width Calibration pulse width in units of `4ns`
- * @return If successful, OK.  Otherwise ERROR.
- */
-int32_t
-vldGetCalibrationPulseWidth(int32_t id, uint32_t *width)
+/* Copy the sample number `index` from the ring of the specified slot.
+   Returns OK, or ERROR if the sample has been overwritten */
+static int32_t
+vldSamplerCopy(vldCrate *crate, int32_t id, uint64_t index, vldTriggerSample *sample)
 {
-  CHECKID(id);
+  vldSampleRing *ring = &crate->mod[id].sampler;
+  uint32_t ientry = index & (VLD_SAMPLER_RING_SIZE - 1);
+  uint64_t seq0, seq1, eindex;
 
-  VLOCK;
-  *width = vmeRead32(&VLDp[id]->calibrationWidth) & VLD_CALIBRATIONWIDTH_MASK;
-  VUNLOCK;
+  do
+    {
+      seq0 = __atomic_load_n(&ring->entry[ientry].seq, __ATOMIC_ACQUIRE);
+      eindex = __atomic_load_n(&ring->entry[ientry].index, __ATOMIC_RELAXED);
+      sample->timestamp = __atomic_load_n(&ring->entry[ientry].sample.timestamp, __ATOMIC_RELAXED);
+      sample->count = __atomic_load_n(&ring->entry[ientry].sample.count, __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      seq1 = __atomic_load_n(&ring->entry[ientry].seq, __ATOMIC_RELAXED);
+    }
+  while((seq0 & 1) || (seq0 != seq1));
 
-  return OK;
+  return (eindex == index) ? OK : ERROR;
+}
+
+static void *
+vldSamplerLoop(void *arg)
+{
+  vldCrate *crate = (vldCrate *)arg;
+  struct timespec next, now;
+  uint32_t mask, raw, resetSeq;
+  uint64_t timestamp;
+  int32_t id;
+
+  clock_gettime(CLOCK_MONOTONIC, &next);
+
+  while(__atomic_load_n(&crate->vldSamplerStopFlag, __ATOMIC_ACQUIRE) == 0)
+    {
+      mask = vldCrateSlotMask(crate);
+      VLD_FOREACH_SLOT(id, mask)
+	{
+	  {
+	    VSTATS(vldSamplerThread, id);
+	    VSLOCK_RD(id);
+	    raw = vldRead32(&crate->mod[id].VLDp->trigCnt);
+	    resetSeq = __atomic_load_n(&crate->st->mod[id].resetSeq, __ATOMIC_ACQUIRE);
+	    clock_gettime(CLOCK_MONOTONIC, &now);
+	    vldPublish(crate, id, offsetof(vldRegs, trigCnt) >> 2, &raw, 1, ~0ULL);
+	    VSUNLOCK(id);
+	  }
+
+	  timestamp = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+	  vldSamplerPush(crate, id, timestamp, raw, resetSeq);
+	}
+
+      next.tv_sec += crate->vldSamplerPeriod / 1000000;
+      next.tv_nsec += (crate->vldSamplerPeriod % 1000000) * 1000;
+      if(next.tv_nsec >= 1000000000)
+	{
+	  next.tv_sec++;
+	  next.tv_nsec -= 1000000000;
+	}
+      while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+	;
+    }
+
+  return NULL;
 }
+/** \endcond */
 
 /**
- * @brief Set the analog switch control
- * @details Set the analog switch control parameters for the specified module
- * @param[in] id Slot ID
- * @param[in] enableDelay `[0,255]` Switch Control delay, in units of 4ns
- * @param[in] enableWidth `[0,127]` Switch Control width, in units of 4ns.  If 0, `width = infinite`.
+ * @brief Start the trigger count sampler
+ * @details Start a thread that reads the trigger count of each
+ * initialized module every period.  The 32bit counts are extended to
+ * 64bits, across wraps, and published with a timestamp to a history of
+ * VLD_SAMPLER_RING_SIZE samples per module.  The history is read,
+ * without locks or bus access, with vldSamplerGetCount and
+ * vldSamplerGetHistory.  The period must be shorter than the time for
+ * trigCnt to wrap.  After a soft reset, or a module replaced by
+ * vldRescan, the low 32bits start again, with the upper bits kept.  A
+ * trigger count reset by other means is seen as a wrap.
+ * @param[in] crate Crate context
+ * @param[in] period Sampling period, in microseconds
  * @return If successful, OK.  Otherwise ERROR.
  */
 int32_t
-vldSetAnalogSwitchControl(int32_t id, uint32_t enableDelay, uint32_t enableWidth)
+vldCrateSamplerStart(vldCrate *crate, uint32_t period)
 {
-  uint32_t maxDelay = 0xFF, maxWidth = 0x7F;
-  CHECKID(id);
-
-  if(enableDelay > maxDelay)
+  if(period == 0)
     {
-      printf("%s(%d): ERROR: Invalid enableDelay (0%x).  Max = 0x%x\n",
-	     __func__, id, enableDelay, maxDelay);
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid period (%u)", period);
       return ERROR;
     }
 
-  if(enableWidth > maxWidth)
+  VLOCKCALL(pthread_mutex_lock, &crate->samplerMutex);
+  if(crate->vldSamplerRunning)
     {
-      printf("%s(%d): ERROR: Invalid enableWidth (0%x).  Max = 0x%x\n",
-	     __func__, id, enableWidth, maxWidth);
+      vldLog(VLD_LOG_ERROR, VLD_ERR_BAD_STATE, -1, "Sampler already running");
+      VLOCKCALL(pthread_mutex_unlock, &crate->samplerMutex);
       return ERROR;
     }
 
-  VLOCK;
-  vmeWrite32(&VLDp[id]->analogCtrl, enableDelay | (enableWidth << 9));
-  VUNLOCK;
+  crate->vldSamplerPeriod = period;
+  crate->vldSamplerStopFlag = 0;
+  if(pthread_create(&crate->vldSamplerThread, NULL, vldSamplerLoop, crate) != 0)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_SYSTEM, -1, "pthread_create failed");
+      VLOCKCALL(pthread_mutex_unlock, &crate->samplerMutex);
+      return ERROR;
+    }
+  crate->vldSamplerRunning = 1;
+  VLOCKCALL(pthread_mutex_unlock, &crate->samplerMutex);
 
   return OK;
 }
 
 /**
- * @brief Get the analog switch control
- * @details Get the analog switch control parameters for the specified module
- * @param[in] id Slot ID
- * @param[out] enableDelay Switch Control delay, in units of 4ns
- * @param[out] enableWidth Switch Control width, in units of 4ns.  If 0, `width = infinite`.
- * @return If successful, OK.  Otherwise ERROR.
+ * @brief vldCrateSamplerStart, for the default crate
  */
 int32_t
-vldGetAnalogSwitchControl(int32_t id, uint32_t *enableDelay, uint32_t *enableWidth)
+vldSamplerStart(uint32_t period)
 {
-  uint32_t rval = 0;
-  CHECKID(id);
-
-  VLOCK;
-  rval = vmeRead32(&VLDp[id]->analogCtrl);
-
-  *enableDelay = rval & VLD_ANALOGCTRL_DELAY_MASK;
-  *enableWidth = (rval & VLD_ANALOGCTRL_WIDTH_MASK) >> 9;
-  VUNLOCK;
-
-  return OK;
+  return vldCrateSamplerStart(&vldDefaultCrate, period);
 }
 
 /**
- * @brief Set the parameters of internal random pulser
- * @details Set the parameters of internal random pulser for the specified module
- * @param[in] id Slot ID
- * @param[in] prescale `[0,7]` Random Pulser Rate prescale. Rate is determined by:
- *      rate ~ (700 kHz) / (2 ** prescale)
- *      e.g. prescale = 5, rate ~ 20 kHz
- * @param[in] enable `[0,1]` Disable (0) / Enable (1) internal random pulser
- * @return Description
+ * @brief Stop the trigger count sampler
+ * @details Stop the sampler thread.  The history is kept, and continues
+ * if the sampler is started again.
+ * @param[in] crate Crate context
+ * @return If successful, OK.  Otherwise ERROR.
  */
 int32_t
-vldSetRandomPulser(int32_t id, uint32_t prescale, uint32_t enable)
+vldCrateSamplerStop(vldCrate *crate)
 {
-  uint32_t maxPrescale = 0x7;
-  CHECKID(id);
-
-  if(prescale > maxPrescale)
+  VLOCKCALL(pthread_mutex_lock, &crate->samplerMutex);
+  if(crate->vldSamplerRunning)
     {
-      printf("%s(%d): ERROR: Invalid prescale 0x%x. Max = %d\n",
-	     __func__, id, prescale, maxPrescale);
+      __atomic_store_n(&crate->vldSamplerStopFlag, 1, __ATOMIC_RELEASE);
+      pthread_join(crate->vldSamplerThread, NULL);
+      crate->vldSamplerRunning = 0;
     }
-
-  enable = enable ? VLD_RANDOMTRIG_ENABLE : 0;
-
-  VLOCK;
-  if(prescale == 0)
-    prescale = vmeRead32(&VLDp[id]->randomTrig) & VLD_RANDOMTRIG_PRESCALE_MASK;
-
-  vmeWrite32(&VLDp[id]->randomTrig, prescale | (prescale << 4) | enable);
-  VUNLOCK;
+  VLOCKCALL(pthread_mutex_unlock, &crate->samplerMutex);
 
   return OK;
 }
 
 /**
- * @brief Get the parameters of internal random pulser
- * @details Get the parameters of internal random pulser for the specified module
- * @param[in] id Slot ID
- * @param[out] prescale Random Pulser Rate prescale. Rate is determined by:
- *      rate ~ (700 kHz) / (2 ** prescale)
- *      e.g. prescale = 5, rate ~ 20 kHz
- * @param[out] enable Disable (0) / Enable (1) internal random pulser
- * @return Description
+ * @brief vldCrateSamplerStop, for the default crate
  */
 int32_t
-vldGetRandomPulser(int32_t id, uint32_t *prescale, uint32_t *enable)
+vldSamplerStop()
 {
-  uint32_t rval = 0;
-  CHECKID(id);
-
-  VLOCK;
-  rval = vmeRead32(&VLDp[id]->randomTrig);
-
-  *prescale = rval & VLD_RANDOMTRIG_PRESCALE_MASK;
-  *enable = (rval & VLD_RANDOMTRIG_ENABLE) ? 1 : 0;
-  VUNLOCK;
-
-  return OK;
+  return vldCrateSamplerStop(&vldDefaultCrate);
 }
 
-
 /**
- * @brief Set the parameters for the internal periodic pulser
- * @details Set the parameters for the internal periodic pulser for the specified module
+ * @brief Get the latest sampled trigger count
+ * @details Get the latest 64bit trigger count from the sampler, and the
+ * trigger rate between the two latest samples.  Does not lock, or
+ * access the module.
+ * @param[in] crate Crate context
  * @param[in] id Slot ID
- * @param[in] period `[0,65535]` Pulser Period
- * @param[in] npulses `[0,65535]` Number of pulses to generate
+ * @param[out] count 64bit trigger count
+ * @param[out] rate If not NULL, trigger rate in Hz.  0 until there are two samples.
  * @return If successful, OK.  Otherwise ERROR.
  */
 int32_t
-vldSetPeriodicPulser(int32_t id, uint32_t period, uint32_t npulses)
+vldCrateSamplerGetCount(vldCrate *crate, int32_t id, uint64_t *count, double *rate)
 {
-  uint32_t maxPeriod = 0xFFFF, maxNpulses = 0xFFFF;
+  vldTriggerSample s[2];
+  int32_t n;
   CHECKID(id);
 
-  if(period > maxPeriod)
+  n = vldCrateSamplerGetHistory(crate, id, s, 2);
+  if(n <= 0)
     {
-      printf("%s(%d): ERROR: Invalid period (%u).  Max = %u.\n",
-	     __func__, id, period, maxPeriod);
+      vldLog(VLD_LOG_ERROR, VLD_ERR_NO_DATA, id, "No samples");
       return ERROR;
     }
 
-  if(npulses > maxNpulses)
+  *count = s[0].count;
+
+  if(rate)
     {
-      printf("%s(%d): WARN: Invalid npulses (%u).  Set to = %u.\n",
-	     __func__, id, npulses, maxNpulses);
-      npulses = maxNpulses;
+      if((n == 2) && (s[0].timestamp > s[1].timestamp))
+	*rate = (double)(s[0].count - s[1].count) * 1e9 /
+	  (double)(s[0].timestamp - s[1].timestamp);
+      else
+	*rate = 0;
     }
 
-  VLOCK;
-  if(period == 0)
-    period = (vmeRead32(&VLDp[id]->periodicTrig) & VLD_PERIODICTRIG_PERIOD_MASK) >> 16;
-
-  vmeWrite32(&VLDp[id]->periodicTrig, npulses | (period << 16));
-  VUNLOCK;
-
   return OK;
 }
 
 /**
- * @brief Get the parameters for the internal periodic pulser
- * @details Get the parameters for the internal periodic pulser for the specified module
- * @param[in] id Slot ID
- * @param[out] period Pulser Period
- * @param[out] npulses Number of pulses to generate
- * @return If successful, OK.  Otherwise ERROR.
+ * @brief vldCrateSamplerGetCount, for the default crate
  */
 int32_t
-vldGetPeriodicPulser(int32_t id, uint32_t *period, uint32_t *npulses)
+vldSamplerGetCount(int32_t id, uint64_t *count, double *rate)
 {
-  uint32_t rval = 0;
-  CHECKID(id);
-
-  VLOCK;
-  rval = vmeRead32(&VLDp[id]->periodicTrig);
-
-  *period = rval & VLD_PERIODICTRIG_NPULSES_MASK;
-  *npulses = (rval & VLD_PERIODICTRIG_PERIOD_MASK) >> 16;
-  VUNLOCK;
-
-  return OK;
+  return vldCrateSamplerGetCount(&vldDefaultCrate, id, count, rate);
 }
 
-
 /**
- * @brief Get the trigger count
- * @details Get the trigger count from the specified module
+ * @brief Get the sampled trigger count history
+ * @details Copy up to nsamples of the latest trigger count samples of
+ * the specified module, newest first.  Does not lock, or access the module.
+ * @param[in] crate Crate context
  * @param[in] id Slot ID
- * @param[out] trigCnt Trigger Count
- * @return If successful, OK.  Otherwise ERROR.
+ * @param[out] samples Array to store the samples
+ * @param[in] nsamples Size of samples
+ * @return Number of samples copied, if successful.  Otherwise ERROR.
  */
 int32_t
-vldGetTriggerCount(int32_t id, uint32_t *trigCnt)
+vldCrateSamplerGetHistory(vldCrate *crate, int32_t id, vldTriggerSample *samples, int32_t nsamples)
 {
+  uint64_t head;
+  int32_t n = 0;
   CHECKID(id);
 
-  VLOCK;
-  *trigCnt = vmeRead32(&VLDp[id]->trigCnt);
-  VUNLOCK;
+  head = __atomic_load_n(&crate->mod[id].sampler.head, __ATOMIC_ACQUIRE);
+  if(nsamples > VLD_SAMPLER_RING_SIZE)
+    nsamples = VLD_SAMPLER_RING_SIZE;
 
-  return OK;
+  while((n < nsamples) && (head > n))
+    {
+      /* Stop at samples that have already been overwritten */
+      if(vldSamplerCopy(crate, id, head - 1 - n, &samples[n]) != OK)
+	break;
+      n++;
+    }
+
+  return n;
 }
 
 /**
- * @brief Reset based on specified reset bits
- * @details Reset the specified module based on the specified reset bits
- * @param[in] id Slot ID
- * @param[in] resetMask Reset Mask
- *     bit | desc
- *        -|-
- *       1 | I2C
- *       2 | JTAG
- *       4 | Clock
- *      10 | MGT
- * @return If successful, OK.  Otherwise ERROR.
+ * @brief vldCrateSamplerGetHistory, for the default crate
  */
 int32_t
-vldResetMask(int32_t id, uint32_t resetMask)
+vldSamplerGetHistory(int32_t id, vldTriggerSample *samples, int32_t nsamples)
 {
-  CHECKID(id);
+  return vldCrateSamplerGetHistory(&vldDefaultCrate, id, samples, nsamples);
+}
 
-  if((resetMask & ~VLD_RESET_MASK) != 0)
+/**
+ * @brief Return the name of an instrumented function
+ * @param[in] func Function index (VLD_STATS_<function name>)
+ * @return Name of the function, or NULL if func is invalid
+ */
+const char *
+vldStatsName(int32_t func)
+{
+/** \cond PRIVATE */
+#define VLD_STATS_NAME(_func) #_func,
+/** \endcond */
+  static const char *names[VLD_STATS_NFUNC] =
     {
-      printf("%s(%d): WARN: Of resetMask (0x%x), only these are defined (0x%x)\n",
-	     __func__, id, resetMask, resetMask & VLD_RESET_MASK);
-    }
+      VLD_STATS_FUNCTIONS(VLD_STATS_NAME)
+    };
 
-  VLOCK;
-  vmeWrite32(&VLDp[id]->reset, resetMask & VLD_RESET_MASK);
-  VUNLOCK;
+  if((func < 0) || (func >= VLD_STATS_NFUNC))
+    return NULL;
 
-  return OK;
+  return names[func];
 }
 
 /**
- * @brief I2C Reset
- * @param[in] id Slot ID
- * @return If successful, OK.  Otherwise ERROR.
+ * @brief Whether the library collects statistics
+ * @return 1 if the library was built with VLD_STATS, otherwise 0.
  */
 int32_t
-vldResetI2C(int32_t id)
+vldStatsAvailable()
 {
-  CHECKID(id);
-
-  VLOCK;
-  vmeWrite32(&VLDp[id]->reset, VLD_RESET_I2C);
-  VUNLOCK;
-
-  return OK;
+#ifdef VLD_STATS
+  return 1;
+#else
+  return 0;
+#endif
 }
 
 /**
- * @brief JTAG Reset
- * @param[in] id Slot ID
+ * @brief Get the library statistics
+ * @details Get the statistics of calls of an instrumented function for
+ * a slot, summed over functions and/or slots if requested.  Each call
+ * is counted once, in the slot it was called for.  Calls that are not
+ * for a single module (e.g. vldInit, vldGStatus, group routines) are
+ * counted in slot 0.  Time in a function includes time in the
+ * instrumented functions it calls, but bus cycles and lock times are
+ * only counted in the innermost function.  Requires the library built
+ * with VLD_STATS.
+ * @param[in] func Function index (VLD_STATS_<function name>), or -1 for all functions
+ * @param[in] id Slot ID, or -1 for all slots
+ * @param[out] stats Statistics
  * @return If successful, OK.  Otherwise ERROR.
  */
 int32_t
-vldResetJTAG(int32_t id)
+vldGetStats(int32_t func, int32_t id, vldStats *stats)
 {
-  CHECKID(id);
+#ifdef VLD_STATS
+  int32_t ifunc, islot, ibucket;
+  vldStats *st;
 
-  VLOCK;
-  vmeWrite32(&VLDp[id]->reset, VLD_RESET_JTAG);
-  VUNLOCK;
+  if((func < -1) || (func >= VLD_STATS_NFUNC) || (id < -1) || (id > MAX_VME_SLOTS) ||
+     (stats == NULL))
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid func (%d) or id (%d)",
+	     func, id);
+      return ERROR;
+    }
+
+  memset(stats, 0, sizeof(vldStats));
+
+  for(ifunc = 0; ifunc < VLD_STATS_NFUNC; ifunc++)
+    {
+      if((func != -1) && (ifunc != func))
+	continue;
+
+      for(islot = 0; islot <= MAX_VME_SLOTS; islot++)
+	{
+	  if((id != -1) && (islot != id))
+	    continue;
+
+	  st = &vldStatsTable[ifunc][islot];
+	  stats->calls += __atomic_load_n(&st->calls, __ATOMIC_RELAXED);
+	  stats->reads += __atomic_load_n(&st->reads, __ATOMIC_RELAXED);
+	  stats->writes += __atomic_load_n(&st->writes, __ATOMIC_RELAXED);
+	  stats->probes += __atomic_load_n(&st->probes, __ATOMIC_RELAXED);
+	  stats->blocks += __atomic_load_n(&st->blocks, __ATOMIC_RELAXED);
+	  stats->time += __atomic_load_n(&st->time, __ATOMIC_RELAXED);
+	  stats->lockWait += __atomic_load_n(&st->lockWait, __ATOMIC_RELAXED);
+	  stats->lockHold += __atomic_load_n(&st->lockHold, __ATOMIC_RELAXED);
+	  for(ibucket = 0; ibucket < VLD_STATS_NBUCKETS; ibucket++)
+	    stats->latency[ibucket] += __atomic_load_n(&st->latency[ibucket], __ATOMIC_RELAXED);
+	}
+    }
 
   return OK;
+#else
+  vldLog(VLD_LOG_ERROR, VLD_ERR_NOT_AVAILABLE, -1, "Library built without VLD_STATS");
+  return ERROR;
+#endif
 }
 
 /**
- * @brief Soft Reset
- * @param[in] id Slot ID
+ * @brief Reset the library statistics
  * @return If successful, OK.  Otherwise ERROR.
  */
 int32_t
-vldSoftReset(int32_t id)
-  {
-  CHECKID(id);
+vldResetStats()
+{
+#ifdef VLD_STATS
+  int32_t ifunc, islot, ibucket;
+  vldStats *st;
 
-  VLOCK;
-  vmeWrite32(&VLDp[id]->reset, VLD_RESET_SOFT);
-  VUNLOCK;
+  for(ifunc = 0; ifunc < VLD_STATS_NFUNC; ifunc++)
+    {
+      for(islot = 0; islot <= MAX_VME_SLOTS; islot++)
+	{
+	  st = &vldStatsTable[ifunc][islot];
+	  __atomic_store_n(&st->calls, 0, __ATOMIC_RELAXED);
+	  __atomic_store_n(&st->reads, 0, __ATOMIC_RELAXED);
+	  __atomic_store_n(&st->writes, 0, __ATOMIC_RELAXED);
+	  __atomic_store_n(&st->probes, 0, __ATOMIC_RELAXED);
+	  __atomic_store_n(&st->blocks, 0, __ATOMIC_RELAXED);
+	  __atomic_store_n(&st->time, 0, __ATOMIC_RELAXED);
+	  __atomic_store_n(&st->lockWait, 0, __ATOMIC_RELAXED);
+	  __atomic_store_n(&st->lockHold, 0, __ATOMIC_RELAXED);
+	  for(ibucket = 0; ibucket < VLD_STATS_NBUCKETS; ibucket++)
+	    __atomic_store_n(&st->latency[ibucket], 0, __ATOMIC_RELAXED);
+	}
+    }
 
   return OK;
+#else
+  vldLog(VLD_LOG_ERROR, VLD_ERR_NOT_AVAILABLE, -1, "Library built without VLD_STATS");
+  return ERROR;
+#endif
 }
 
-/**
- * @brief Clock DCM Reset
- * @param[in] id Slot ID
- * @return If successful, OK.  Otherwise ERROR.
- */
-int32_t
-vldResetClockDCM(int32_t id)
+/** \cond PRIVATE */
+#ifdef VLD_STATS
+/* One row of the statistics summary */
+static void
+vldPrintStatsRow(const char *name, int32_t id, vldStats *st, int32_t pFlag)
 {
-  CHECKID(id);
+  int32_t ibucket;
 
-  VLOCK;
-  vmeWrite32(&VLDp[id]->reset, VLD_RESET_CLK);
-  VUNLOCK;
+  if(id < 0)
+    printf("%-28s  all ", name);
+  else
+    printf("%-28s  %2d  ", name, id);
 
-  return OK;
+  printf("%9llu %9llu %8llu %6llu %6llu %10.0f %9.0f %9.0f\n",
+	 (unsigned long long)st->calls, (unsigned long long)st->reads,
+	 (unsigned long long)st->writes, (unsigned long long)st->probes,
+	 (unsigned long long)st->blocks,
+	 (double)st->time / st->calls,
+	 (double)st->lockWait / st->calls, (double)st->lockHold / st->calls);
+
+  if(pFlag & 0x2)
+    {
+      printf("      latency[ns]:");
+      for(ibucket = 0; ibucket < VLD_STATS_NBUCKETS; ibucket++)
+	{
+	  if(st->latency[ibucket])
+	    printf(" <%llu:%llu", 1ULL << ibucket, (unsigned long long)st->latency[ibucket]);
+	}
+      printf("\n");
+    }
 }
+#endif
+/** \endcond */
 
 /**
- * @brief MGT Reset
- * @param[in] id Slot ID
- * @return If successful, OK.  Otherwise ERROR.
+ * @brief Show the library statistics
+ * @details Show the calls, bus cycles, and average time and lock times
+ * of each instrumented function that has been called.
+ * @param[in] pFlag Print option bits
+ *     bit | desc
+ *        -|-
+ *       0 | Show each slot
+ *       1 | Show the latency histograms
  */
-int32_t
-vldResetMGT(int32_t id)
+void
+vldPrintStats(int32_t pFlag)
 {
-  CHECKID(id);
+#ifdef VLD_STATS
+  vldStats st;
+  int32_t ifunc, islot;
 
-  VLOCK;
-  vmeWrite32(&VLDp[id]->reset, VLD_RESET_MGT);
-  VUNLOCK;
+  printf("VLD Library Statistics\n");
+  printf("                                                                         Average[ns]..................\n");
+  printf("Function                      Slot     Calls     Reads   Writes Probes Blocks       Time  LockWait  LockHold\n");
+  printf("---------------------------------------------------------------------------------------------------------\n");
 
-  return OK;
-}
+  for(ifunc = 0; ifunc < VLD_STATS_NFUNC; ifunc++)
+    {
+      vldGetStats(ifunc, -1, &st);
+      if(st.calls == 0)
+	continue;
 
-int32_t
-vldHardClockReset(int32_t id)
-{
-  CHECKID(id);
+      vldPrintStatsRow(vldStatsName(ifunc), -1, &st, pFlag);
 
-  VLOCK;
-  vmeWrite32(&VLDp[id]->reset, VLD_RESET_HARD_CLK);
-  VUNLOCK;
+      if((pFlag & 0x1) == 0)
+	continue;
 
-  return OK;
+      for(islot = 0; islot <= MAX_VME_SLOTS; islot++)
+	{
+	  vldGetStats(ifunc, islot, &st);
+	  if(st.calls)
+	    vldPrintStatsRow("", islot, &st, pFlag);
+	}
+    }
+  printf("\n");
+#else
+  vldLog(VLD_LOG_ERROR, VLD_ERR_NOT_AVAILABLE, -1, "Library built without VLD_STATS");
+#endif
 }
@@ -14,6 +14,19 @@
 
 /** \cond PRIVATE */
 #include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+#ifdef VLD_SIM_ONLY
+/* Built without jvme, define what is otherwise taken from it */
+#ifndef OK
+#define OK 0
+#endif
+#ifndef ERROR
+#define ERROR -1
+#endif
+typedef unsigned int UINT32;
+#endif
 
 
 /* Automatically generate unique blank register names */
@@ -70,12 +83,116 @@ typedef struct
   /* 0x20000 */ volatile uint32_t data[(0x10000)>>2];
 } vldSerialRegs;
 
+/* Register map.  X(offset, member of vldRegs, field group, access) for every
+   register of vldRegs.  The fields of each group are in VLD_FIELDS */
+#define VLD_REG_RO  1
+#define VLD_REG_WO  2
+#define VLD_REG_RW  3
+
+#define VLD_REGISTERS(X)						\
+  X(0x000, boardID,             boardID,          VLD_REG_RO)		\
+  X(0x00C, trigDelay,           trigDelay,        VLD_REG_RW)		\
+  X(0x020, trigSrc,             trigSrc,          VLD_REG_RW)		\
+  X(0x02C, clockSrc,            clockSrc,         VLD_REG_RW)		\
+  X(0x040, output[0].low_ctrl,  ledLow,           VLD_REG_RW)		\
+  X(0x044, output[0].high,      ledHigh,          VLD_REG_RW)		\
+  X(0x048, output[1].low_ctrl,  ledLow,           VLD_REG_RW)		\
+  X(0x04C, output[1].high,      ledHigh,          VLD_REG_RW)		\
+  X(0x050, output[2].low_ctrl,  ledLow,           VLD_REG_RW)		\
+  X(0x054, output[2].high,      ledHigh,          VLD_REG_RW)		\
+  X(0x058, output[3].low_ctrl,  ledLow,           VLD_REG_RW)		\
+  X(0x05C, output[3].high,      ledHigh,          VLD_REG_RW)		\
+  X(0x060, output[4].low_ctrl,  ledLow,           VLD_REG_RW)		\
+  X(0x064, output[4].high,      ledHigh,          VLD_REG_RW)		\
+  X(0x068, bleachTime,          bleachTime,       VLD_REG_RW)		\
+  X(0x06C, pulseLoad,           pulseLoad,        VLD_REG_WO)		\
+  X(0x070, calibrationWidth,    calibrationWidth, VLD_REG_RW)		\
+  X(0x074, analogCtrl,          analogCtrl,       VLD_REG_RW)		\
+  X(0x088, randomTrig,          randomTrig,       VLD_REG_RW)		\
+  X(0x08C, periodicTrig,        periodicTrig,     VLD_REG_RW)		\
+  X(0x0DC, trigCnt,             trigCnt,          VLD_REG_RO)		\
+  X(0x100, reset,               reset,            VLD_REG_WO)
+
+/* Register fields.  X(field group, field, lowest bit, number of bits) */
+#define VLD_FIELDS(X)							\
+  X(boardID,          CRATEID,           0,  8)			\
+  X(boardID,          GEOADR,            8,  5)			\
+  X(boardID,          VME64X,           13,  1)			\
+  X(boardID,          TYPE,             16, 16)			\
+  X(trigDelay,        DELAY,             0,  7)			\
+  X(trigDelay,        STEP16NS,          7,  1)			\
+  X(trigDelay,        WIDTH,             8,  5)			\
+  X(trigSrc,          PERIODIC,          0,  1)			\
+  X(trigSrc,          RANDOM,            1,  1)			\
+  X(trigSrc,          SEQUENCE,          2,  1)			\
+  X(trigSrc,          EXTERNAL,          4,  1)			\
+  X(clockSrc,         SOURCE,            0,  1)			\
+  X(ledLow,           CALIBRATION,       0,  1)			\
+  X(ledLow,           CHANNELS,          1, 18)			\
+  X(ledLow,           BLEACH_CTRL,      24,  3)			\
+  X(ledLow,           BLEACH_REG_ENABLE, 27, 1)			\
+  X(ledLow,           BLEACH_ENABLE,    28,  4)			\
+  X(ledHigh,          CHANNELS,          1, 18)			\
+  X(bleachTime,       TIMER,             0, 28)			\
+  X(bleachTime,       ENABLE,           28,  4)			\
+  X(pulseLoad,        DAC,               0,  6)			\
+  X(pulseLoad,        DAC_ZERO,          6,  1)			\
+  X(pulseLoad,        GEN_TRIG,          7,  1)			\
+  X(calibrationWidth, WIDTH,             0, 10)			\
+  X(analogCtrl,       DELAY,             0,  8)			\
+  X(analogCtrl,       RESERVED,          8,  1)			\
+  X(analogCtrl,       WIDTH,             9,  7)			\
+  X(randomTrig,       PRESCALE,          0,  3)			\
+  X(randomTrig,       PRESCALE_HI,       4,  3)			\
+  X(randomTrig,       ENABLE,            7,  1)			\
+  X(periodicTrig,     NPULSES,           0, 16)			\
+  X(periodicTrig,     PERIOD,           16, 16)			\
+  X(trigCnt,          COUNT,             0, 32)			\
+  X(reset,            I2C,               1,  1)			\
+  X(reset,            JTAG,              2,  1)			\
+  X(reset,            SOFT,              4,  1)			\
+  X(reset,            CLK,               8,  1)			\
+  X(reset,            MGT,              10,  1)			\
+  X(reset,            HARD_CLK,         21,  1)
+
+/** \cond PRIVATE */
+#define VLD_FIELD_ENUM(_group, _field, _shift, _width)			\
+  VLD_F_##_group##_##_field##_SHIFT = _shift,				\
+  VLD_F_##_group##_##_field##_WIDTH = _width,
+enum { VLD_FIELDS(VLD_FIELD_ENUM) };
+/** \endcond */
+
+/* Largest value, and mask, of a field.  Constant expressions */
+#define VLD_FIELD_MAX(_group, _field)					\
+  ((uint32_t)((1ULL << VLD_F_##_group##_##_field##_WIDTH) - 1))
+#define VLD_FIELD_MASK(_group, _field)					\
+  (VLD_FIELD_MAX(_group, _field) << VLD_F_##_group##_##_field##_SHIFT)
+
+/* Encode and decode of each field: vldEncode_<group>_<field>(value),
+   vldDecode_<group>_<field>(register), and vldValid_<group>_<field>(value) */
+#define VLD_FIELD_FUNCTIONS(_group, _field, _shift, _width)		\
+  static inline uint32_t						\
+  vldEncode_##_group##_##_field(uint32_t val)				\
+  { return (val & VLD_FIELD_MAX(_group, _field)) << _shift; }		\
+  static inline uint32_t						\
+  vldDecode_##_group##_##_field(uint32_t rval)				\
+  { return (rval >> _shift) & VLD_FIELD_MAX(_group, _field); }		\
+  static inline int32_t							\
+  vldValid_##_group##_##_field(uint32_t val)				\
+  { return val <= VLD_FIELD_MAX(_group, _field); }
+VLD_FIELDS(VLD_FIELD_FUNCTIONS)
+
 /* Firmware Masks */
 #define VLD_FIRMWARE_ID_MASK              0x000000FF
 
+/* Read back from an unimplemented register (0xBADADD21: V2.2, 0xBADADD24: V2.4) */
+#define VLD_BADADDR                       0xBADADD00
+#define VLD_BADADDR_MASK                  0xFFFFFF00
+
 
 /* 0x0 boardID bits and masks */
 #define VLD_BOARDID_TYPE_VLD          0x1EDD
+#define VLD_BOARDID_TYPE_VLD_V22      0x7501  /* firmware V2.2 */
 #define VLD_BOARDID_TYPE_MASK     0xFFFF0000
 #define VLD_BOARDID_VME64X        (1 << 13)
 #define VLD_BOARDID_PROD_MASK     0x00FF0000
@@ -143,19 +260,185 @@ typedef struct
 #define VLD_INIT_NO_INIT                 (1<<0)
 #define VLD_INIT_SKIP_FIRMWARE_CHECK     (1<<2)
 #define VLD_INIT_USE_ADDR_LIST           (1<<3)
+#define VLD_INIT_IGNORE_CACHE            (1<<4)
+
+/* vldRescan flag bits */
+#define VLD_RESCAN_NO_VERIFY             (1<<0)
+#define VLD_RESCAN_NO_PROBE              (1<<1)
+
+/* Crates kept in the discovery cache file */
+#define VLD_DISCOVERY_MAX_CRATES  16
 
 #ifndef MAX_VME_SLOTS
 /** This is either 20 or 21 */
 #define MAX_VME_SLOTS 21
 #endif
 
+/* Register access backend */
+typedef struct
+{
+  const char *name;
+  uint32_t (*read32)(volatile uint32_t *addr);
+  void     (*write32)(volatile uint32_t *addr, uint32_t wval);
+  int32_t  (*memProbe)(volatile uint32_t *addr, uint32_t *rval);   /* < 0 if no response */
+  int32_t  (*busToLocal)(uint32_t vmeAddr, uintptr_t *localAddr);  /* A24, 0 if successful */
+  void     (*setQuiet)(int32_t quiet);                               /* Suppress bus error messages */
+  int32_t  maxProbes;                                                /* memProbe calls allowed at once */
+  /* A24 block read of nwords from addr (vmeAddr on the bus), in bus (big endian) byte
+     order.  The words read, < 0 if failed.  NULL if the backend has no block reads */
+  int32_t  (*blockRead)(volatile uint32_t *addr, uint32_t vmeAddr, uint32_t *data, uint32_t nwords);
+  /* Chained block read (CBLT) of nwords, from offset, of each module in slotMask, in slot
+     order and bus byte order.  The words read, < 0 if failed.  NULL if the backend has none */
+  int32_t  (*chainedRead)(uint32_t slotMask, uint32_t offset, uint32_t *data, uint32_t nwords);
+} vldBackend;
+
+#ifndef VLD_SIM_ONLY
+extern const vldBackend vldHardwareBackend;
+#endif
+extern const vldBackend vldSimBackend;
+
+/* Simulated crate, for vldSimBackend */
+typedef struct
+{
+  uint32_t readLatency;             /* ns per single cycle read */
+  uint32_t writeLatency;            /* ns per single cycle write */
+  uint32_t probeTimeout;            /* ns for a probe of an empty slot (bus error) */
+  int32_t  serialBus;               /* 1: one bus cycle at a time, 0: cycles may overlap */
+  uint32_t blockLatency;            /* ns per word of a block read, after a readLatency cycle */
+} vldSimTiming;
+
+typedef struct
+{
+  uint64_t reads;
+  uint64_t writes;
+  uint64_t probes;
+  uint64_t busErrors;
+  uint64_t blockReads;
+  uint64_t chainedReads;
+} vldSimCounters;
+
+int32_t  vldSimConfigure(uint32_t slotMask, uint32_t firmware, uint32_t crateID);
+int32_t  vldSimSetTiming(const vldSimTiming *timing);
+void     vldSimGetCounters(vldSimCounters *counters);
+void     vldSimResetCounters();
+
+/* Crate context, with its own modules and locks.  The routines without a
+   crate use a default crate */
+typedef struct vldCrate vldCrate;
+
+/* Time for the clock to settle, before the clock DCM reset, after a clock source switch */
+#define VLD_CLOCK_SETTLE_US  1000000
+
+typedef void (*vldClockDoneFunction)(int32_t id, int32_t status, void *arg);
+
+/* Clock source switch, started with vldSetClockSourceAsync */
+typedef struct
+{
+  uint32_t slotMask;                /* Modules being switched */
+  volatile uint32_t doneMask;       /* Modules whose clock DCM reset has been issued */
+  uint32_t clkSrc;
+  vldClockDoneFunction callback;
+  void *arg;
+  /** \cond PRIVATE */
+  vldCrate *crate;
+  struct timespec deadline;
+  pthread_t thread;
+  int32_t threadStarted;
+  /** \endcond */
+} vldClockSwitch;
+
+/* Decoded status of a module, from vldGetStatusSnapshot.  X(member) of
+   each uint32_t member, in the order of the binary record:
+   slot, firmware, boardID, trigSrc (VLD_TRIGSRC_* bits), clockSrc,
+   trigDelay, trigDelayStep, trigWidth (as vldGetTriggerDelayWidth),
+   bleachTimer, bleachEnable, calibrationWidth, analogDelay, analogWidth,
+   randomPrescale, randomEnable, periodicPeriod, periodicNPulses, trigCnt */
+#define VLD_STATUS_FIELDS(X)						\
+  X(slot) X(firmware) X(boardID) X(trigSrc) X(clockSrc)			\
+  X(trigDelay) X(trigDelayStep) X(trigWidth)				\
+  X(bleachTimer) X(bleachEnable) X(calibrationWidth)			\
+  X(analogDelay) X(analogWidth)						\
+  X(randomPrescale) X(randomEnable) X(periodicPeriod) X(periodicNPulses) \
+  X(trigCnt)
+
+/* and of each LED connector (as vldGetLEDCalibration) */
+#define VLD_OUTPUT_STATUS_FIELDS(X)					\
+  X(lochanEnableMask) X(hichanEnableMask) X(ctrlLDO) X(enableLDO)
+
+/** \cond PRIVATE */
+#define VLD_STATUS_MEMBER(_name) uint32_t _name;
+/** \endcond */
+
+typedef struct
+{
+  VLD_OUTPUT_STATUS_FIELDS(VLD_STATUS_MEMBER)
+} vldOutputStatus;
+
+typedef struct
+{
+  VLD_STATUS_FIELDS(VLD_STATUS_MEMBER)
+  vldOutputStatus output[5];
+} vldStatus;
+
+/* Binary status record: a header of 4 little endian words (VLD_STATUS_MAGIC,
+   VLD_STATUS_VERSION | words per module << 16, modules, 0), then the words of
+   each vldStatus, little endian */
+#define VLD_STATUS_MAGIC    0x53444C56   /* "VLDS" */
+#define VLD_STATUS_VERSION  1
+
+/* Status delta, from vldGetStatusDelta.  A header of 2 little endian words
+   (VLD_DELTA_MAGIC, VLD_STATUS_VERSION | flags << 8 | records << 16) and the
+   64bit token.  Then each record: the slot (1 byte), record flags (1 byte),
+   the 64bit mask of the vldStatus words that changed, and those words, in
+   order.  All little endian */
+#define VLD_DELTA_MAGIC     0x44444C56   /* "VLDD" */
+#define VLD_DELTA_FULL      (1<<0)       /* flags: every module, not the changes */
+#define VLD_DELTA_REMOVED   (1<<0)       /* record flags: the module was removed */
+#define VLD_DELTA_CONSUMERS 8            /* consumers whose latest token is kept */
+
+/* Trigger count sampler history, per module.  Must be a power of 2 */
+#define VLD_SAMPLER_RING_SIZE  256
+
+typedef struct
+{
+  uint64_t timestamp;               /* CLOCK_MONOTONIC, in ns */
+  uint64_t count;                   /* trigCnt, extended to 64bits */
+} vldTriggerSample;
+
+int32_t  vldSetBackend(const vldBackend *backend);
+const vldBackend *vldGetBackend();
+
 int32_t  vldCheckAddresses();
+int32_t  vldSetDiscoveryCache(const char *path);
+int32_t  vldSetArena(void *arena, size_t size);
+size_t   vldArenaRequired(uint32_t ncrates);
+int32_t  vldGetArenaUsage(size_t *used, size_t *size);
+int32_t  vldAttachShared(const char *name);
+int32_t  vldUnlinkShared(const char *name);
 int32_t  vldInit(uint32_t vme_addr, uint32_t vme_incr, uint32_t nincr, uint32_t iFlag);
+int32_t  vldRescan(uint32_t flags);
 int32_t  vldSlot(uint32_t index);
 uint32_t vldSlotMask();
 int32_t  vldGetGeoAddress(int id);
+int32_t  vldGetFirmwareVersion(int32_t id);
+int32_t  vldGetA24Address(int32_t id);
+
+int32_t  vldCacheInvalidate(int32_t id);
+int32_t  vldCacheRefresh(int32_t id);
+
+int32_t  vldConfigBegin(int32_t id);
+int32_t  vldConfigCommit(int32_t id);
+int32_t  vldConfigAbort(int32_t id);
 
 void     vldGStatus(int32_t pFlag);
+int32_t  vldReadImage(int32_t id, vldRegs *image);
+int32_t  vldGReadWindow(uint32_t slotMask, uint32_t offset, uint32_t nwords, uint32_t *data);
+int32_t  vldGetStatusSnapshot(vldStatus *status, int32_t nstatus);
+int32_t  vldGetPublishedStatus(int32_t id, vldStatus *status, uint64_t *valid, uint64_t *timestamp);
+int32_t  vldStatusToBinary(const vldStatus *status, int32_t nstatus, void *buf, size_t size);
+int32_t  vldStatusToJSON(const vldStatus *status, int32_t nstatus, char *buf, size_t size);
+int32_t  vldGetStatusDelta(uint64_t since, uint64_t *token, void *buf, size_t size);
+int32_t  vldStatusApplyDelta(vldStatus *status, uint32_t *slotMask, const void *buf, size_t len);
 
 int32_t  vldSetTriggerDelayWidth(int32_t id, int32_t delay, int32_t delaystep, int32_t width);
 int32_t  vldGetTriggerDelayWidth(int32_t id, int32_t *delay, int32_t *delaystep, int32_t *width);
@@ -165,10 +448,19 @@ int32_t  vldGetTriggerSourceMask(int32_t id, uint32_t *trigSrc);
 
 int32_t  vldSetClockSource(int32_t id, uint32_t clkSrc);
 int32_t  vldGetClockSource(int32_t id, uint32_t *clkSrc);
+int32_t  vldGSetClockSource(uint32_t clkSrc);
+
+int32_t  vldSetClockSourceAsync(vldClockSwitch *cs, uint32_t slotMask, uint32_t clkSrc,
+				vldClockDoneFunction callback, void *arg);
+int32_t  vldClockSwitchWait(vldClockSwitch *cs);
+uint32_t vldClockSwitchDoneMask(vldClockSwitch *cs);
 
 int32_t  vldLEDCalibration(int32_t id, uint32_t connector,
 			   uint32_t lochanEnableMask, uint32_t hichanEnableMask,
 			   uint32_t ctrlLDO, uint32_t enableLDO);
+int32_t  vldGetLEDCalibration(int32_t id, uint32_t connector,
+			      uint32_t *lochanEnableMask, uint32_t *hichanEnableMask,
+			      uint32_t *ctrlLDO, uint32_t *enableLDO);
 
 int32_t  vldSetBleachTime(int32_t id, uint32_t timer, uint32_t enable);
 int32_t  vldGetBleachTime(int32_t id, uint32_t *timer, uint32_t *enable);
@@ -188,6 +480,12 @@ int32_t  vldSetPeriodicPulser(int32_t id, uint32_t period, uint32_t npulses);
 int32_t  vldGetPeriodicPulser(int32_t id, uint32_t *period, uint32_t *npulses);
 
 int32_t  vldGetTriggerCount(int32_t id, uint32_t *trigCnt);
+int32_t  vldGGetTriggerCount(uint32_t *trigCnt);
+
+int32_t  vldSamplerStart(uint32_t period);
+int32_t  vldSamplerStop();
+int32_t  vldSamplerGetCount(int32_t id, uint64_t *count, double *rate);
+int32_t  vldSamplerGetHistory(int32_t id, vldTriggerSample *samples, int32_t nsamples);
 
 int32_t  vldResetMask(int32_t id, uint32_t resetMask);
 int32_t  vldResetI2C(int32_t id);
@@ -197,4 +495,271 @@ int32_t  vldResetClockDCM(int32_t id);
 int32_t  vldResetMGT(int32_t id);
 int32_t  vldHardClockReset(int32_t id);
 
-#define vldG(_function, ...) {int32_t _iv; for(_iv = 0; _iv < nVLD; _iv) _function(## __VA_ARGS__);}
+/* Group operations */
+#define VLD_G_DEFAULT_WORKERS  4
+
+typedef int32_t (*vldSlotFunction)(int32_t id, void *arg);
+
+int32_t  vldGSetWorkers(int32_t nworkers);
+int32_t  vldGExecuteMask(uint32_t slotMask, vldSlotFunction func, void *arg, int32_t *results);
+int32_t  vldGExecute(vldSlotFunction func, void *arg, int32_t *results);
+
+/* Serially call _function(id, ...) for each initialized VLD */
+#define vldG(_function, ...) {						\
+    uint32_t _vm = vldSlotMask(); int32_t _iv;				\
+    for(_iv = 0; _iv <= MAX_VME_SLOTS; _iv++)				\
+      if(_vm & (1 << _iv)) _function(_iv, ## __VA_ARGS__);}
+
+/* Crate bring-up.  Stages of vldBringUp, run if their bit is set in stages */
+#define VLD_BRINGUP_INIT      (1<<0)  /* vldInit */
+#define VLD_BRINGUP_CLOCK     (1<<1)  /* vldSetClockSource */
+#define VLD_BRINGUP_PULSE     (1<<2)  /* vldLoadPulse32 */
+#define VLD_BRINGUP_TRIGDELAY (1<<3)  /* vldSetTriggerDelayWidth */
+#define VLD_BRINGUP_LED       (1<<4)  /* vldLEDCalibration, of each connector in led[] */
+#define VLD_BRINGUP_BLEACH    (1<<5)  /* vldSetBleachTime */
+#define VLD_BRINGUP_RANDOM    (1<<6)  /* vldSetRandomPulser */
+#define VLD_BRINGUP_PERIODIC  (1<<7)  /* vldSetPeriodicPulser */
+#define VLD_BRINGUP_TRIGSRC   (1<<8)  /* vldSetTriggerSourceMask, once the clock is settled */
+
+#define VLD_BRINGUP_MAX_LED   5
+
+typedef struct
+{
+  uint32_t stages;
+  uint32_t slotMask;                /* modules to configure.  0 for every initialized module */
+
+  uint32_t vmeAddr, vmeIncr, nincr, iFlag;  /* vldInit */
+  uint32_t clkSrc;
+  const uint32_t *pulse;            /* vldLoadPulse32 */
+  uint32_t npulse;
+  int32_t  trigDelay, trigDelayStep, trigWidth;
+  uint32_t nled;
+  struct
+  {
+    uint32_t connector, lochanEnableMask, hichanEnableMask, ctrlLDO, enableLDO;
+  } led[VLD_BRINGUP_MAX_LED];
+  uint32_t bleachTimer, bleachEnable;
+  uint32_t randomPrescale, randomEnable;
+  uint32_t periodicPeriod, periodicNpulses;
+  uint32_t trigSrc;
+} vldBringUpConfig;
+
+/* Phases of a bring-up, in order */
+enum
+  {
+    VLD_BRINGUP_PHASE_INIT,         /* vldInit */
+    VLD_BRINGUP_PHASE_CLOCK,        /* clock source writes */
+    VLD_BRINGUP_PHASE_SETTLE,       /* clock settle interval, of every module at once, and DCM resets */
+    VLD_BRINGUP_PHASE_CONFIG,       /* pulse shape and registers, of every module at once */
+    VLD_BRINGUP_PHASE_ENABLE,       /* trigger sources */
+    VLD_BRINGUP_NPHASES
+  };
+
+typedef struct
+{
+  uint32_t slotMask;                /* modules brought up */
+  uint32_t failMask;                /* modules that failed a stage */
+  uint64_t phaseNs[VLD_BRINGUP_NPHASES];   /* wall time of each phase */
+  uint64_t totalNs;
+  uint64_t configNs[MAX_VME_SLOTS+1];      /* configuration time of each module */
+} vldBringUpReport;
+
+int32_t  vldBringUp(const vldBringUpConfig *config, vldBringUpReport *report);
+
+/* Crate contexts.  Each routine above, for the specified crate */
+vldCrate *vldCrateCreate(const vldBackend *backend);
+int32_t  vldCrateDestroy(vldCrate *crate);
+vldCrate *vldCrateDefault();
+int32_t  vldCrateSetAddrList(vldCrate *crate, const uint32_t *addrList, uint32_t naddr);
+int32_t  vldCrateAttachShared(vldCrate *crate, const char *name);
+int32_t  vldCrateBringUp(vldCrate *crate, const vldBringUpConfig *config,
+			 vldBringUpReport *report);
+
+int32_t  vldCrateSetBackend(vldCrate *crate, const vldBackend *backend);
+const vldBackend *vldCrateGetBackend(vldCrate *crate);
+int32_t  vldCrateInit(vldCrate *crate, uint32_t vme_addr, uint32_t vme_incr,
+		      uint32_t nincr, uint32_t iFlag);
+int32_t  vldCrateRescan(vldCrate *crate, uint32_t flags);
+int32_t  vldCrateSlot(vldCrate *crate, uint32_t index);
+uint32_t vldCrateSlotMask(vldCrate *crate);
+int32_t  vldCrateGetGeoAddress(vldCrate *crate, int id);
+int32_t  vldCrateGetFirmwareVersion(vldCrate *crate, int32_t id);
+int32_t  vldCrateGetA24Address(vldCrate *crate, int32_t id);
+int32_t  vldCrateCacheInvalidate(vldCrate *crate, int32_t id);
+int32_t  vldCrateCacheRefresh(vldCrate *crate, int32_t id);
+int32_t  vldCrateConfigBegin(vldCrate *crate, int32_t id);
+int32_t  vldCrateConfigCommit(vldCrate *crate, int32_t id);
+int32_t  vldCrateConfigAbort(vldCrate *crate, int32_t id);
+void     vldCrateGStatus(vldCrate *crate, int32_t pFlag);
+int32_t  vldCrateReadImage(vldCrate *crate, int32_t id, vldRegs *image);
+int32_t  vldCrateGReadWindow(vldCrate *crate, uint32_t slotMask, uint32_t offset, uint32_t nwords,
+			     uint32_t *data);
+int32_t  vldCrateGetStatusSnapshot(vldCrate *crate, vldStatus *status, int32_t nstatus);
+int32_t  vldCrateGetPublishedStatus(vldCrate *crate, int32_t id, vldStatus *status,
+				    uint64_t *valid, uint64_t *timestamp);
+int32_t  vldCrateGetStatusDelta(vldCrate *crate, uint64_t since, uint64_t *token, void *buf, size_t size);
+int32_t  vldCrateSetTriggerDelayWidth(vldCrate *crate, int32_t id, int32_t delay,
+				      int32_t delaystep, int32_t width);
+int32_t  vldCrateGetTriggerDelayWidth(vldCrate *crate, int32_t id, int32_t *delay,
+				      int32_t *delaystep, int32_t *width);
+int32_t  vldCrateSetTriggerSourceMask(vldCrate *crate, int32_t id, uint32_t trigSrc);
+int32_t  vldCrateGetTriggerSourceMask(vldCrate *crate, int32_t id, uint32_t *trigSrc);
+int32_t  vldCrateSetClockSource(vldCrate *crate, int32_t id, uint32_t clkSrc);
+int32_t  vldCrateGetClockSource(vldCrate *crate, int32_t id, uint32_t *clkSrc);
+int32_t  vldCrateGSetClockSource(vldCrate *crate, uint32_t clkSrc);
+int32_t  vldCrateSetClockSourceAsync(vldCrate *crate, vldClockSwitch *cs,
+				     uint32_t slotMask, uint32_t clkSrc,
+				     vldClockDoneFunction callback, void *arg);
+int32_t  vldCrateLEDCalibration(vldCrate *crate, int32_t id, uint32_t connector,
+				uint32_t lochanEnableMask, uint32_t hichanEnableMask,
+				uint32_t ctrlLDO, uint32_t enableLDO);
+int32_t  vldCrateGetLEDCalibration(vldCrate *crate, int32_t id, uint32_t connector,
+				   uint32_t *lochanEnableMask, uint32_t *hichanEnableMask,
+				   uint32_t *ctrlLDO, uint32_t *enableLDO);
+int32_t  vldCrateSetBleachTime(vldCrate *crate, int32_t id, uint32_t timer, uint32_t enable);
+int32_t  vldCrateGetBleachTime(vldCrate *crate, int32_t id, uint32_t *timer, uint32_t *enable);
+int32_t  vldCrateLoadPulse(vldCrate *crate, int32_t id, uint8_t *dac_samples,
+			   uint32_t nsamples);
+int32_t  vldCrateLoadPulse32(vldCrate *crate, int32_t id, uint32_t *dac_samples,
+			     uint32_t nsamples);
+int32_t  vldCrateSetCalibrationPulseWidth(vldCrate *crate, int32_t id, uint32_t width);
+int32_t  vldCrateGetCalibrationPulseWidth(vldCrate *crate, int32_t id, uint32_t *width);
+int32_t  vldCrateSetAnalogSwitchControl(vldCrate *crate, int32_t id, uint32_t enableDelay,
+					uint32_t enableWidth);
+int32_t  vldCrateGetAnalogSwitchControl(vldCrate *crate, int32_t id, uint32_t *enableDelay,
+					uint32_t *enableWidth);
+int32_t  vldCrateSetRandomPulser(vldCrate *crate, int32_t id, uint32_t prescale,
+				 uint32_t enable);
+int32_t  vldCrateGetRandomPulser(vldCrate *crate, int32_t id, uint32_t *prescale,
+				 uint32_t *enable);
+int32_t  vldCrateSetPeriodicPulser(vldCrate *crate, int32_t id, uint32_t period,
+				   uint32_t npulses);
+int32_t  vldCrateGetPeriodicPulser(vldCrate *crate, int32_t id, uint32_t *period,
+				   uint32_t *npulses);
+int32_t  vldCrateGetTriggerCount(vldCrate *crate, int32_t id, uint32_t *trigCnt);
+int32_t  vldCrateGGetTriggerCount(vldCrate *crate, uint32_t *trigCnt);
+int32_t  vldCrateSamplerStart(vldCrate *crate, uint32_t period);
+int32_t  vldCrateSamplerStop(vldCrate *crate);
+int32_t  vldCrateSamplerGetCount(vldCrate *crate, int32_t id, uint64_t *count, double *rate);
+int32_t  vldCrateSamplerGetHistory(vldCrate *crate, int32_t id, vldTriggerSample *samples,
+				   int32_t nsamples);
+int32_t  vldCrateResetMask(vldCrate *crate, int32_t id, uint32_t resetMask);
+int32_t  vldCrateResetI2C(vldCrate *crate, int32_t id);
+int32_t  vldCrateResetJTAG(vldCrate *crate, int32_t id);
+int32_t  vldCrateSoftReset(vldCrate *crate, int32_t id);
+int32_t  vldCrateResetClockDCM(vldCrate *crate, int32_t id);
+int32_t  vldCrateResetMGT(vldCrate *crate, int32_t id);
+int32_t  vldCrateHardClockReset(vldCrate *crate, int32_t id);
+int32_t  vldCrateGExecuteMask(vldCrate *crate, uint32_t slotMask, vldSlotFunction func,
+			      void *arg, int32_t *results);
+int32_t  vldCrateGExecute(vldCrate *crate, vldSlotFunction func, void *arg, int32_t *results);
+
+/* Statistics, per function and slot.  Collected when built with VLD_STATS (make STATS=1) */
+#define VLD_STATS_NBUCKETS  32
+
+typedef struct
+{
+  uint64_t calls;
+  uint64_t reads;                   /* single cycle bus reads */
+  uint64_t writes;                  /* single cycle bus writes */
+  uint64_t probes;                  /* bus probes */
+  uint64_t blocks;                  /* block transfers */
+  uint64_t time;                    /* ns in the function */
+  uint64_t lockWait;                /* ns waiting for module locks */
+  uint64_t lockHold;                /* ns holding module locks */
+  uint64_t latency[VLD_STATS_NBUCKETS];  /* calls taking [2**(i-1), 2**i) ns */
+} vldStats;
+
+/* Instrumented functions.  vldSamplerThread and vldClockSwitchThread are the
+   background threads of the sampler and clock source switch */
+#define VLD_STATS_FUNCTIONS(X)						\
+  X(vldInit) X(vldRescan) X(vldGetGeoAddress)				\
+  X(vldCacheInvalidate) X(vldCacheRefresh)				\
+  X(vldConfigBegin) X(vldConfigCommit) X(vldConfigAbort) X(vldGStatus) \
+  X(vldReadImage) X(vldGReadWindow) X(vldGetStatusSnapshot)		\
+  X(vldGetStatusDelta) X(vldGetPublishedStatus)			\
+  X(vldSetTriggerDelayWidth) X(vldGetTriggerDelayWidth)		\
+  X(vldSetTriggerSourceMask) X(vldGetTriggerSourceMask)		\
+  X(vldSetClockSource) X(vldGSetClockSource) X(vldSetClockSourceAsync) \
+  X(vldClockSwitchThread) X(vldGetClockSource) X(vldLEDCalibration)	\
+  X(vldGetLEDCalibration)						\
+  X(vldSetBleachTime) X(vldGetBleachTime) X(vldLoadPulse) X(vldLoadPulse32) \
+  X(vldSetCalibrationPulseWidth) X(vldGetCalibrationPulseWidth)	\
+  X(vldSetAnalogSwitchControl) X(vldGetAnalogSwitchControl)		\
+  X(vldSetRandomPulser) X(vldGetRandomPulser)				\
+  X(vldSetPeriodicPulser) X(vldGetPeriodicPulser)			\
+  X(vldGetTriggerCount) X(vldSamplerThread)				\
+  X(vldResetMask) X(vldResetI2C) X(vldResetJTAG) X(vldSoftReset)	\
+  X(vldResetClockDCM) X(vldResetMGT) X(vldHardClockReset)		\
+  X(vldGExecuteMask)
+
+/** \cond PRIVATE */
+#define VLD_STATS_ENUM(_func) VLD_STATS_##_func,
+/** \endcond */
+enum
+  {
+    VLD_STATS_FUNCTIONS(VLD_STATS_ENUM)
+    VLD_STATS_NFUNC
+  };
+
+int32_t  vldStatsAvailable();
+int32_t  vldGetStats(int32_t func, int32_t id, vldStats *stats);
+int32_t  vldResetStats();
+const char *vldStatsName(int32_t func);
+void     vldPrintStats(int32_t pFlag);
+
+/* Logging.  Messages are queued without blocking, and written by a drain
+   thread (started with the first message), or by vldLogFlush */
+#define VLD_LOG_RING_SIZE          256       /* Must be a power of 2 */
+#define VLD_LOG_MESSAGE_SIZE       120
+#define VLD_LOG_DRAIN_PERIOD_US    100000
+#define VLD_LOG_RATE_LIMIT         10        /* messages per second, from each call site */
+
+/* Severity */
+#define VLD_LOG_INFO     0
+#define VLD_LOG_WARN     1
+#define VLD_LOG_ERROR    2
+
+/* Error codes */
+#define VLD_ERR_NONE               0
+#define VLD_ERR_NOT_INITIALIZED    1         /* Slot ID is not an initialized module */
+#define VLD_ERR_INVALID_ARG        2         /* Argument out of range */
+#define VLD_ERR_BAD_STATE          3         /* Not allowed in the current state */
+#define VLD_ERR_NO_MODULE          4         /* No (valid) module found */
+#define VLD_ERR_BUS                5         /* VME bus mapping or access error */
+#define VLD_ERR_SYSTEM             6         /* Thread, lock, or memory error */
+#define VLD_ERR_NOT_AVAILABLE      7         /* Not built into the library */
+#define VLD_ERR_NO_DATA            8         /* Nothing to return, yet */
+
+typedef struct
+{
+  uint64_t timestamp;               /* CLOCK_MONOTONIC, in ns */
+  int32_t  severity;
+  int32_t  code;
+  int32_t  id;                      /* Slot ID, or -1 if not for a single module */
+  uint32_t suppressed;              /* Messages from this call site dropped by the rate limit, before this one */
+  const char *function;
+  char     message[VLD_LOG_MESSAGE_SIZE];
+} vldLogEntry;
+
+typedef void (*vldLogHandler)(const vldLogEntry *entry, void *arg);
+
+int32_t  vldLogFlush();
+int32_t  vldLogSetDrain(uint32_t period);
+void     vldLogSetHandler(vldLogHandler handler, void *arg);
+void     vldLogSetLevel(int32_t severity);
+void     vldLogSetRateLimit(uint32_t rate);
+void     vldLogGetCounters(uint64_t *dropped, uint64_t *suppressed);
+
+int32_t  vldGetLastError(vldLogEntry *entry);
+void     vldClearLastError();
+const char *vldErrorString(int32_t code);
+
+/** \cond PRIVATE */
+void     vldLogPost(int32_t severity, int32_t code, int32_t id, const char *function,
+		    uint32_t line, const char *fmt, ...)
+  __attribute__((format(printf, 6, 7)));
+
+#define vldLog(_severity, _code, _id, _fmt, ...)			\
+  vldLogPost(_severity, _code, _id, __func__, __LINE__, _fmt, ## __VA_ARGS__)
+/** \endcond */
@@ -0,0 +1,472 @@
+/**
+ * @copyright Copyright 2022, Jefferson Science Associates, LLC.
+ *            Subject to the terms in the LICENSE file found in the
+ *            top-level directory.
+ *
+ * @author    Bryan Moffit
+ *            moffit@jlab.org                   Jefferson Lab, MS-12B3
+ *            Phone: (757) 269-5660             12000 Jefferson Ave.
+ *            Fax:   (757) 269-5800             Newport News, VA 23606
+ *
+ * @file      vldLog.c
+ * @brief     Non-blocking logging for the VLD library
+ *
+ */
+
+/** \cond PRIVATE */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#ifndef VLD_SIM_ONLY
+#include "jvme.h"
+#endif
+#include "vldLib.h"
+
+#define VLD_LOG_RING_MASK    (VLD_LOG_RING_SIZE - 1)
+#define VLD_LOG_NSITES       64     /* Must be a power of 2 */
+
+/* Bounded multi-producer queue.  A cell is free for the message numbered
+   seq, and holds message seq-1 when its seq is one more */
+typedef struct
+{
+  uint64_t seq;
+  vldLogEntry entry;
+} vldLogCell;
+
+static vldLogCell vldLogRing[VLD_LOG_RING_SIZE];
+static uint64_t vldLogHead = 0;          /* next message to post */
+static uint64_t vldLogTail = 0;          /* next message to drain, guarded by vldLogMutex */
+static pthread_once_t vldLogOnce = PTHREAD_ONCE_INIT;
+
+/* Rate limit, per call site.  Sites that share an entry may lose counts */
+typedef struct
+{
+  uintptr_t key;
+  uint64_t second;
+  uint32_t count;
+  uint32_t suppressed;
+} vldLogSite;
+
+static vldLogSite vldLogSites[VLD_LOG_NSITES];
+static uint32_t vldLogRate = VLD_LOG_RATE_LIMIT;
+static int32_t vldLogLevel = VLD_LOG_INFO;
+static uint64_t vldLogDropped = 0;       /* ring was full */
+static uint64_t vldLogSuppressed = 0;    /* over the rate limit */
+
+/* Writing the messages */
+static pthread_mutex_t vldLogMutex = PTHREAD_MUTEX_INITIALIZER;
+static vldLogHandler vldLogOutput = NULL;
+static void *vldLogOutputArg = NULL;
+
+/* Drain thread, guarded by vldLogDrainMutex */
+static pthread_mutex_t vldLogDrainMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t vldLogDrainCond = PTHREAD_COND_INITIALIZER;
+static pthread_t vldLogDrainThread;
+static int32_t vldLogDrainRunning = 0;
+static int32_t vldLogDrainStop = 0;
+static uint32_t vldLogDrainPeriod = VLD_LOG_DRAIN_PERIOD_US;
+
+/* Last error of this thread */
+static __thread vldLogEntry vldLastError;
+
+static void
+vldLogAtExit()
+{
+  vldLogFlush();
+}
+
+static void
+vldLogInit()
+{
+  uint64_t icell;
+
+  for(icell = 0; icell < VLD_LOG_RING_SIZE; icell++)
+    vldLogRing[icell].seq = icell;
+
+  /* Don't lose queued messages at exit */
+  atexit(vldLogAtExit);
+}
+
+static uint64_t
+vldLogNow()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Count the message against the rate limit of its call site.
+   Returns the number of messages suppressed before it, or -1 if it is suppressed */
+static int64_t
+vldLogRateCheck(const char *function, uint32_t line, uint64_t timestamp)
+{
+  uintptr_t key = (uintptr_t)function ^ ((uintptr_t)line << 16);
+  vldLogSite *site = &vldLogSites[(key ^ (key >> 7) ^ line) & (VLD_LOG_NSITES - 1)];
+  uint64_t second = timestamp / 1000000000ULL;
+  uint32_t rate = __atomic_load_n(&vldLogRate, __ATOMIC_RELAXED);
+  uint32_t suppressed = 0;
+
+  if(rate == 0)
+    return 0;
+
+  if((__atomic_load_n(&site->key, __ATOMIC_RELAXED) != key) ||
+     (__atomic_load_n(&site->second, __ATOMIC_RELAXED) != second))
+    {
+      /* New second, or another call site */
+      if(__atomic_exchange_n(&site->key, key, __ATOMIC_RELAXED) == key)
+	suppressed = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+      else
+	__atomic_store_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+      __atomic_store_n(&site->second, second, __ATOMIC_RELAXED);
+      __atomic_store_n(&site->count, 0, __ATOMIC_RELAXED);
+    }
+
+  if(__atomic_fetch_add(&site->count, 1, __ATOMIC_RELAXED) >= rate)
+    {
+      __atomic_fetch_add(&site->suppressed, 1, __ATOMIC_RELAXED);
+      __atomic_fetch_add(&vldLogSuppressed, 1, __ATOMIC_RELAXED);
+      return -1;
+    }
+
+  return suppressed;
+}
+
+/* Default handler, to stdout */
+static void
+vldLogPrint(const vldLogEntry *entry, void *arg)
+{
+  static const char *severity[] = { "INFO", "WARN", "ERROR" };
+
+  if(entry->severity == VLD_LOG_INFO)
+    printf("%s: %s", entry->function, entry->message);
+  else if(entry->id >= 0)
+    printf("%s(%d): %s: %s", entry->function, entry->id,
+	   severity[entry->severity], entry->message);
+  else
+    printf("%s: %s: %s", entry->function,
+	   severity[entry->severity], entry->message);
+
+  if(entry->suppressed)
+    printf(" (%u similar messages suppressed)", entry->suppressed);
+
+  printf("\n");
+}
+
+static void *
+vldLogDrainLoop(void *arg)
+{
+  struct timespec next;
+
+  pthread_mutex_lock(&vldLogDrainMutex);
+  while(vldLogDrainStop == 0)
+    {
+      clock_gettime(CLOCK_REALTIME, &next);
+      next.tv_sec += vldLogDrainPeriod / 1000000;
+      next.tv_nsec += (vldLogDrainPeriod % 1000000) * 1000;
+      if(next.tv_nsec >= 1000000000)
+	{
+	  next.tv_sec++;
+	  next.tv_nsec -= 1000000000;
+	}
+      pthread_cond_timedwait(&vldLogDrainCond, &vldLogDrainMutex, &next);
+
+      pthread_mutex_unlock(&vldLogDrainMutex);
+      vldLogFlush();
+      pthread_mutex_lock(&vldLogDrainMutex);
+    }
+  pthread_mutex_unlock(&vldLogDrainMutex);
+
+  return NULL;
+}
+
+/* Start the drain thread, if it's enabled and not running */
+static void
+vldLogDrainStart()
+{
+  pthread_mutex_lock(&vldLogDrainMutex);
+  if((vldLogDrainRunning == 0) && (vldLogDrainPeriod > 0))
+    {
+      vldLogDrainStop = 0;
+      if(pthread_create(&vldLogDrainThread, NULL, vldLogDrainLoop, NULL) == 0)
+	vldLogDrainRunning = 1;
+      else
+	vldLogDrainPeriod = 0;  /* Leave it to vldLogFlush */
+    }
+  pthread_mutex_unlock(&vldLogDrainMutex);
+}
+/** \endcond */
+
+/**
+ * @brief Queue a message
+ * @details Used by the library through the vldLog macro.  Formats the
+ * message into the log ring, without blocking.  If the ring is full,
+ * or the call site is over its rate limit, the message is counted and
+ * dropped.  Errors are also recorded as the calling thread's last error.
+ * @param[in] severity VLD_LOG_INFO, VLD_LOG_WARN, or VLD_LOG_ERROR
+ * @param[in] code Error code
+ * @param[in] id Slot ID, or -1 if not for a single module
+ * @param[in] function Name of the calling function
+ * @param[in] line Line of the call
+ * @param[in] fmt printf format of the message
+ */
+void
+vldLogPost(int32_t severity, int32_t code, int32_t id, const char *function,
+	   uint32_t line, const char *fmt, ...)
+{
+  vldLogCell *cell;
+  uint64_t pos, seq, timestamp;
+  int64_t suppressed;
+  va_list args;
+
+  timestamp = vldLogNow();
+
+  if(severity == VLD_LOG_ERROR)
+    {
+      vldLastError.timestamp = timestamp;
+      vldLastError.severity = severity;
+      vldLastError.code = code;
+      vldLastError.id = id;
+      vldLastError.suppressed = 0;
+      vldLastError.function = function;
+      va_start(args, fmt);
+      vsnprintf(vldLastError.message, VLD_LOG_MESSAGE_SIZE, fmt, args);
+      va_end(args);
+    }
+
+  if(severity < __atomic_load_n(&vldLogLevel, __ATOMIC_RELAXED))
+    return;
+
+  pthread_once(&vldLogOnce, vldLogInit);
+
+  suppressed = vldLogRateCheck(function, line, timestamp);
+  if(suppressed < 0)
+    return;
+
+  /* Claim a cell */
+  pos = __atomic_load_n(&vldLogHead, __ATOMIC_RELAXED);
+  while(1)
+    {
+      cell = &vldLogRing[pos & VLD_LOG_RING_MASK];
+      seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+
+      if(seq == pos)
+	{
+	  if(__atomic_compare_exchange_n(&vldLogHead, &pos, pos + 1, 1,
+					 __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	    break;
+	}
+      else if((int64_t)(seq - pos) < 0)
+	{
+	  /* Full */
+	  __atomic_fetch_add(&vldLogDropped, 1, __ATOMIC_RELAXED);
+	  return;
+	}
+      else
+	pos = __atomic_load_n(&vldLogHead, __ATOMIC_RELAXED);
+    }
+
+  cell->entry.timestamp = timestamp;
+  cell->entry.severity = severity;
+  cell->entry.code = code;
+  cell->entry.id = id;
+  cell->entry.suppressed = suppressed;
+  cell->entry.function = function;
+  va_start(args, fmt);
+  vsnprintf(cell->entry.message, VLD_LOG_MESSAGE_SIZE, fmt, args);
+  va_end(args);
+
+  __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+
+  if(__atomic_load_n(&vldLogDrainRunning, __ATOMIC_RELAXED) == 0)
+    vldLogDrainStart();
+}
+
+/**
+ * @brief Write the queued messages
+ * @details Pass each queued message, in order, to the log handler
+ * (stdout by default).  Stops at a message that is still being
+ * queued.  May be called from any thread.
+ * @return Number of messages written
+ */
+int32_t
+vldLogFlush()
+{
+  vldLogCell *cell;
+  vldLogEntry entry;
+  int32_t n = 0;
+
+  pthread_once(&vldLogOnce, vldLogInit);
+
+  pthread_mutex_lock(&vldLogMutex);
+  while(1)
+    {
+      cell = &vldLogRing[vldLogTail & VLD_LOG_RING_MASK];
+      if(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != vldLogTail + 1)
+	break;
+
+      entry = cell->entry;
+      __atomic_store_n(&cell->seq, vldLogTail + VLD_LOG_RING_SIZE, __ATOMIC_RELEASE);
+      vldLogTail++;
+
+      if(vldLogOutput)
+	(*vldLogOutput)(&entry, vldLogOutputArg);
+      else
+	vldLogPrint(&entry, NULL);
+      n++;
+    }
+  if(n && (vldLogOutput == NULL))
+    fflush(stdout);
+  pthread_mutex_unlock(&vldLogMutex);
+
+  return n;
+}
+
+/**
+ * @brief Set the period of the log drain thread
+ * @details The drain thread writes the queued messages every period.
+ * It is started with the first message.  If the period is 0, the
+ * thread is stopped, and messages are only written by vldLogFlush.
+ * @param[in] period Drain period, in microseconds.  0 for none.
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldLogSetDrain(uint32_t period)
+{
+  int32_t running;
+
+  pthread_mutex_lock(&vldLogDrainMutex);
+  vldLogDrainPeriod = period;
+  running = vldLogDrainRunning;
+  if(running)
+    {
+      vldLogDrainStop = 1;
+      pthread_cond_signal(&vldLogDrainCond);
+    }
+  pthread_mutex_unlock(&vldLogDrainMutex);
+
+  if(running)
+    {
+      pthread_join(vldLogDrainThread, NULL);
+      pthread_mutex_lock(&vldLogDrainMutex);
+      vldLogDrainRunning = 0;
+      pthread_mutex_unlock(&vldLogDrainMutex);
+    }
+
+  /* Write what's left, then restart with the new period */
+  vldLogFlush();
+  if(period > 0)
+    vldLogDrainStart();
+
+  return OK;
+}
+
+/**
+ * @brief Set the log handler
+ * @details Messages are passed to the handler by the drain thread, or
+ * vldLogFlush, one at a time.
+ * @param[in] handler Routine to write a message.  NULL for the default (stdout)
+ * @param[in] arg Argument passed to the handler
+ */
+void
+vldLogSetHandler(vldLogHandler handler, void *arg)
+{
+  pthread_mutex_lock(&vldLogMutex);
+  vldLogOutput = handler;
+  vldLogOutputArg = arg;
+  pthread_mutex_unlock(&vldLogMutex);
+}
+
+/**
+ * @brief Set the lowest severity that is logged
+ * @param[in] severity VLD_LOG_INFO (default), VLD_LOG_WARN, or VLD_LOG_ERROR
+ */
+void
+vldLogSetLevel(int32_t severity)
+{
+  __atomic_store_n(&vldLogLevel, severity, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Set the rate limit
+ * @details Limit the messages queued from each call site in the
+ * library, per second.  The number of messages dropped is reported
+ * with the next message from the call site.
+ * @param[in] rate Messages per second, per call site.  0 for no limit.
+ */
+void
+vldLogSetRateLimit(uint32_t rate)
+{
+  __atomic_store_n(&vldLogRate, rate, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Get the number of messages that were not queued
+ * @param[out] dropped If not NULL, messages dropped because the log ring was full
+ * @param[out] suppressed If not NULL, messages dropped by the rate limit
+ */
+void
+vldLogGetCounters(uint64_t *dropped, uint64_t *suppressed)
+{
+  if(dropped)
+    *dropped = __atomic_load_n(&vldLogDropped, __ATOMIC_RELAXED);
+  if(suppressed)
+    *suppressed = __atomic_load_n(&vldLogSuppressed, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Get the last error of this thread
+ * @details Get the last error reported by the library in the calling
+ * thread, whether or not its message was logged.
+ * @param[out] entry If not NULL, the last error
+ * @return Error code of the last error, VLD_ERR_NONE if there has been none
+ */
+int32_t
+vldGetLastError(vldLogEntry *entry)
+{
+  if(entry)
+    *entry = vldLastError;
+
+  return vldLastError.code;
+}
+
+/**
+ * @brief Clear the last error of this thread
+ */
+void
+vldClearLastError()
+{
+  memset(&vldLastError, 0, sizeof(vldLastError));
+}
+
+/**
+ * @brief Return a description of an error code
+ * @param[in] code Error code
+ * @return Description
+ */
+const char *
+vldErrorString(int32_t code)
+{
+  static const char *desc[] =
+    {
+      [VLD_ERR_NONE]            = "No error",
+      [VLD_ERR_NOT_INITIALIZED] = "Module not initialized",
+      [VLD_ERR_INVALID_ARG]     = "Invalid argument",
+      [VLD_ERR_BAD_STATE]       = "Not allowed in the current state",
+      [VLD_ERR_NO_MODULE]       = "No valid module found",
+      [VLD_ERR_BUS]             = "VME bus error",
+      [VLD_ERR_SYSTEM]          = "System error",
+      [VLD_ERR_NOT_AVAILABLE]   = "Not available in this build",
+      [VLD_ERR_NO_DATA]         = "No data",
+    };
+
+  if((code < 0) || (code >= (int32_t)(sizeof(desc)/sizeof(desc[0]))))
+    return "Unknown error";
+
+  return desc[code];
+}
@@ -0,0 +1,494 @@
+/**
+ * @copyright Copyright 2022, Jefferson Science Associates, LLC.
+ *            Subject to the terms in the LICENSE file found in the
+ *            top-level directory.
+ *
+ * @author    Bryan Moffit
+ *            moffit@jlab.org                   Jefferson Lab, MS-12B3
+ *            Phone: (757) 269-5660             12000 Jefferson Ave.
+ *            Fax:   (757) 269-5800             Newport News, VA 23606
+ *
+ * @file      vldSim.c
+ * @brief     Simulated crate of VME LED Drivers, as a register access backend
+ *
+ */
+
+/** \cond PRIVATE */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#ifndef VLD_SIM_ONLY
+#include "jvme.h"
+#endif
+#include "vldLib.h"
+
+/* Size of the simulated A24 address space, and of each slot's window */
+#define SIM_A24_SIZE       0x01000000
+#define SIM_SLOT_SHIFT     19
+#define SIM_REG_WINDOW     0x10000
+#define SIM_FIRMWARE_REG   0x7C
+#define SIM_PULSE_FIFO     512
+#define SIM_SLEEP_MIN      10000    /* ns, bus cycles at least this long sleep instead of spin */
+
+/* Model of a single VLD */
+typedef struct
+{
+  int32_t  present;
+  uint32_t reg[(sizeof(vldRegs) >> 2)];
+  uint32_t firmware;
+  uint32_t pulse[SIM_PULSE_FIFO];   /* pulseLoad FIFO */
+  uint32_t npulse;                  /* words written to the pulseLoad FIFO */
+  uint64_t trigBase;                /* trigger count at trigStart */
+  uint64_t trigStart;               /* ns, when the trigger settings were last changed */
+} simSlot;
+
+static simSlot simCrate[MAX_VME_SLOTS+1];
+static uintptr_t simBase = 0;       /* local address of A24 0x000000 */
+static uint32_t simCrateID = 0;
+static vldSimTiming simTiming = { 0, 0, 0, 1, 0 };
+static vldSimCounters simCount;
+static pthread_mutex_t simMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t simBusMutex = PTHREAD_MUTEX_INITIALIZER;
+
+#define REGWORD(_reg) (offsetof(vldRegs, _reg) >> 2)
+
+static uint64_t
+simNow()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Hold the bus for the specified time */
+static void
+simBusCycle(uint32_t ns)
+{
+  uint64_t start;
+
+  if(ns == 0)
+    return;
+
+  if(simTiming.serialBus)
+    pthread_mutex_lock(&simBusMutex);
+
+  if(ns >= SIM_SLEEP_MIN)
+    {
+      /* Long enough to block, like a thread stalled on the bus */
+      struct timespec wait = { ns / 1000000000, ns % 1000000000 };
+      while(nanosleep(&wait, &wait) != 0)
+	;
+    }
+  else
+    {
+      start = simNow();
+      while((simNow() - start) < ns)
+	;
+    }
+
+  if(simTiming.serialBus)
+    pthread_mutex_unlock(&simBusMutex);
+}
+
+/* Reserve the local address range of the simulated A24 space.  Never accessed directly. */
+static int32_t
+simMap()
+{
+  void *base;
+
+  if(simBase != 0)
+    return OK;
+
+  base = mmap(NULL, SIM_A24_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(base == MAP_FAILED)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_SYSTEM, -1, "mmap failed");
+      return ERROR;
+    }
+  simBase = (uintptr_t)base;
+
+  return OK;
+}
+
+/* Decode a local address to the simulated slot and register word.
+   Returns the slot, or ERROR if nothing responds at that address */
+static int32_t
+simDecode(volatile uint32_t *addr, uint32_t *offset)
+{
+  uintptr_t a24 = (uintptr_t)addr - simBase;
+  int32_t slot;
+
+  if((simBase == 0) || ((uintptr_t)addr < simBase) || (a24 >= SIM_A24_SIZE))
+    return ERROR;
+
+  slot = a24 >> SIM_SLOT_SHIFT;
+  *offset = a24 & ((1 << SIM_SLOT_SHIFT) - 1);
+
+  if((slot > MAX_VME_SLOTS) || (simCrate[slot].present == 0))
+    return ERROR;
+
+  return slot;
+}
+
+/* Trigger rate of the slot from its pulser settings, in Hz */
+static double
+simTriggerRate(simSlot *s)
+{
+  uint32_t trigSrc = s->reg[REGWORD(trigSrc)];
+  uint32_t randomTrig = s->reg[REGWORD(randomTrig)];
+  uint32_t period = (s->reg[REGWORD(periodicTrig)] & VLD_PERIODICTRIG_PERIOD_MASK) >> 16;
+  double rate = 0;
+
+  if((trigSrc & VLD_TRIGSRC_INTERNAL_RANDOM_ENABLE) && (randomTrig & VLD_RANDOMTRIG_ENABLE))
+    rate += 700000 >> (randomTrig & VLD_RANDOMTRIG_PRESCALE_MASK);
+
+  if(trigSrc & VLD_TRIGSRC_INTERNAL_PERIODIC_ENABLE)
+    rate += 1e9 / (120 + 30 * period);
+
+  return rate;
+}
+
+static uint64_t
+simTriggerCount(simSlot *s, uint64_t now)
+{
+  return s->trigBase + (uint64_t)(simTriggerRate(s) * (now - s->trigStart) * 1e-9);
+}
+
+static uint32_t
+simRead(simSlot *s, uint32_t offset)
+{
+  uint32_t word = offset >> 2;
+
+  if(offset >= SIM_REG_WINDOW)
+    return 0;
+
+  if(offset == SIM_FIRMWARE_REG)
+    return s->firmware;
+
+  if(word == REGWORD(trigCnt))
+    return (uint32_t)simTriggerCount(s, simNow());
+
+  if((word == REGWORD(pulseLoad)) || (word == REGWORD(reset)))
+    return 0;
+
+  if(offset < sizeof(vldRegs))
+    {
+      /* Unused addresses in the register map read back the bad address pattern */
+      if((word == REGWORD(boardID)) || (word == REGWORD(trigDelay)) ||
+	 (word == REGWORD(trigSrc)) || (word == REGWORD(clockSrc)) ||
+	 ((word >= REGWORD(output)) && (word <= REGWORD(analogCtrl))) ||
+	 (word == REGWORD(randomTrig)) || (word == REGWORD(periodicTrig)))
+	return s->reg[word];
+    }
+
+  return (s->firmware < 0x24) ? 0xBADADD21 : 0xBADADD24;
+}
+
+static void
+simWrite(simSlot *s, uint32_t offset, uint32_t wval)
+{
+  uint32_t word = offset >> 2;
+  uint64_t now;
+
+  if((offset >= sizeof(vldRegs)) || (word == REGWORD(boardID)) || (word == REGWORD(trigCnt)))
+    return;
+
+  if(word == REGWORD(pulseLoad))
+    {
+      s->pulse[s->npulse % SIM_PULSE_FIFO] = wval;
+      s->npulse++;
+      return;
+    }
+
+  if(word == REGWORD(reset))
+    {
+      if(wval & VLD_RESET_SOFT)
+	{
+	  uint32_t boardID = s->reg[REGWORD(boardID)];
+	  memset(s->reg, 0, sizeof(s->reg));
+	  s->reg[REGWORD(boardID)] = boardID;
+	  s->npulse = 0;
+	  s->trigBase = 0;
+	  s->trigStart = simNow();
+	}
+      return;
+    }
+
+  if((word == REGWORD(trigSrc)) || (word == REGWORD(randomTrig)) ||
+     (word == REGWORD(periodicTrig)))
+    {
+      /* Rebase the trigger count on the new rate */
+      now = simNow();
+      s->trigBase = simTriggerCount(s, now);
+      s->trigStart = now;
+    }
+
+  s->reg[word] = wval;
+}
+
+static uint32_t
+simRead32(volatile uint32_t *addr)
+{
+  uint32_t offset, rval;
+  int32_t slot;
+
+  __atomic_fetch_add(&simCount.reads, 1, __ATOMIC_RELAXED);
+  simBusCycle(simTiming.readLatency);
+
+  slot = simDecode(addr, &offset);
+  if(slot < 0)
+    {
+      __atomic_fetch_add(&simCount.busErrors, 1, __ATOMIC_RELAXED);
+      return 0xFFFFFFFF;
+    }
+
+  pthread_mutex_lock(&simMutex);
+  rval = simRead(&simCrate[slot], offset);
+  pthread_mutex_unlock(&simMutex);
+
+  return rval;
+}
+
+static void
+simWrite32(volatile uint32_t *addr, uint32_t wval)
+{
+  uint32_t offset;
+  int32_t slot;
+
+  __atomic_fetch_add(&simCount.writes, 1, __ATOMIC_RELAXED);
+  simBusCycle(simTiming.writeLatency);
+
+  slot = simDecode(addr, &offset);
+  if(slot < 0)
+    {
+      __atomic_fetch_add(&simCount.busErrors, 1, __ATOMIC_RELAXED);
+      return;
+    }
+
+  pthread_mutex_lock(&simMutex);
+  simWrite(&simCrate[slot], offset, wval);
+  pthread_mutex_unlock(&simMutex);
+}
+
+static int32_t
+simMemProbe(volatile uint32_t *addr, uint32_t *rval)
+{
+  uint32_t offset;
+  int32_t slot;
+
+  __atomic_fetch_add(&simCount.probes, 1, __ATOMIC_RELAXED);
+
+  slot = simDecode(addr, &offset);
+  if(slot < 0)
+    {
+      __atomic_fetch_add(&simCount.busErrors, 1, __ATOMIC_RELAXED);
+      simBusCycle(simTiming.probeTimeout);
+      return ERROR;
+    }
+
+  simBusCycle(simTiming.readLatency);
+
+  pthread_mutex_lock(&simMutex);
+  *rval = simRead(&simCrate[slot], offset);
+  pthread_mutex_unlock(&simMutex);
+
+  return OK;
+}
+
+static int32_t
+simBlockRead(volatile uint32_t *addr, uint32_t vmeAddr, uint32_t *data, uint32_t nwords)
+{
+  uint32_t offset, iword;
+  int32_t slot;
+
+  __atomic_fetch_add(&simCount.blockReads, 1, __ATOMIC_RELAXED);
+  simBusCycle(simTiming.readLatency + nwords * simTiming.blockLatency);
+
+  slot = simDecode(addr, &offset);
+  if(slot < 0)
+    {
+      __atomic_fetch_add(&simCount.busErrors, 1, __ATOMIC_RELAXED);
+      return ERROR;
+    }
+
+  /* In bus byte order, as from a DMA */
+  pthread_mutex_lock(&simMutex);
+  for(iword = 0; iword < nwords; iword++)
+    {
+      data[iword] = simRead(&simCrate[slot], offset + (iword << 2));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      data[iword] = __builtin_bswap32(data[iword]);
+#endif
+    }
+  pthread_mutex_unlock(&simMutex);
+
+  return nwords;
+}
+
+/* Each module in slotMask, in slot order, in one transaction */
+static int32_t
+simChainedRead(uint32_t slotMask, uint32_t offset, uint32_t *data, uint32_t nwords)
+{
+  uint32_t islot, iword, nread = 0;
+
+  __atomic_fetch_add(&simCount.chainedReads, 1, __ATOMIC_RELAXED);
+  simBusCycle(simTiming.readLatency + __builtin_popcount(slotMask) * nwords * simTiming.blockLatency);
+
+  pthread_mutex_lock(&simMutex);
+  for(islot = 0; islot <= MAX_VME_SLOTS; islot++)
+    {
+      if(!(slotMask & (1 << islot)))
+	continue;
+
+      if(!simCrate[islot].present)
+	{
+	  /* The chain is broken */
+	  pthread_mutex_unlock(&simMutex);
+	  __atomic_fetch_add(&simCount.busErrors, 1, __ATOMIC_RELAXED);
+	  return ERROR;
+	}
+
+      for(iword = 0; iword < nwords; iword++, nread++)
+	{
+	  data[nread] = simRead(&simCrate[islot], offset + (iword << 2));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	  data[nread] = __builtin_bswap32(data[nread]);
+#endif
+	}
+    }
+  pthread_mutex_unlock(&simMutex);
+
+  return nread;
+}
+
+static int32_t
+simBusToLocal(uint32_t vmeAddr, uintptr_t *localAddr)
+{
+  if((vmeAddr >= SIM_A24_SIZE) || (simMap() != OK))
+    return ERROR;
+
+  *localAddr = simBase + vmeAddr;
+
+  return OK;
+}
+
+/* Nothing to suppress: a probe of an empty slot returns < 0, and the
+   simulated bus prints no bus error messages */
+static void
+simSetQuiet(int32_t quiet)
+{
+}
+
+/** \endcond */
+
+const vldBackend vldSimBackend =
+  {
+    .name       = "sim",
+    .read32     = simRead32,
+    .write32    = simWrite32,
+    .memProbe   = simMemProbe,
+    .busToLocal = simBusToLocal,
+    .setQuiet   = simSetQuiet,
+    .maxProbes  = 16,
+    .blockRead  = simBlockRead,
+    .chainedRead = simChainedRead,
+  };
+
+/**
+ * @brief Populate the simulated crate
+ * @details Place a simulated VLD, with its registers at their reset
+ * values, in each of the specified slots.  Each is at A24 address
+ * (slot << 19), with the geographic address and crate ID in its boardID.
+ * Firmware older than 0x24 reports the V2.2 boardID (0x7501xxxx).
+ * @param[in] slotMask Mask of slots with a VLD
+ * @param[in] firmware Firmware version, read back from 0x7C
+ * @param[in] crateID `[0,255]` Crate ID, read back in boardID
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldSimConfigure(uint32_t slotMask, uint32_t firmware, uint32_t crateID)
+{
+  int32_t slot;
+  uint32_t type = (firmware < 0x24) ? 0x7501 : VLD_BOARDID_TYPE_VLD;
+
+  if(crateID > VLD_BOARDID_CRATEID_MASK)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid crateID (%d)", crateID);
+      return ERROR;
+    }
+
+  if(simMap() != OK)
+    return ERROR;
+
+  pthread_mutex_lock(&simMutex);
+  simCrateID = crateID;
+  memset(simCrate, 0, sizeof(simCrate));
+  for(slot = 1; slot <= MAX_VME_SLOTS; slot++)
+    {
+      if((slotMask & (1 << slot)) == 0)
+	continue;
+
+      simCrate[slot].present = 1;
+      simCrate[slot].firmware = firmware;
+      simCrate[slot].reg[REGWORD(boardID)] =
+	(type << 16) | VLD_BOARDID_VME64X | (slot << 8) | simCrateID;
+      simCrate[slot].trigStart = simNow();
+    }
+  pthread_mutex_unlock(&simMutex);
+
+  return OK;
+}
+
+/**
+ * @brief Set the timing of the simulated bus
+ * @param[in] timing Latency of each type of bus access
+ * @return If successful, OK.  Otherwise ERROR.
+ */
+int32_t
+vldSimSetTiming(const vldSimTiming *timing)
+{
+  if(timing == NULL)
+    {
+      vldLog(VLD_LOG_ERROR, VLD_ERR_INVALID_ARG, -1, "Invalid timing");
+      return ERROR;
+    }
+
+  simTiming = *timing;
+
+  return OK;
+}
+
+/**
+ * @brief Get the number of simulated bus accesses
+ * @param[out] counters Bus access counters since the last vldSimResetCounters
+ */
+void
+vldSimGetCounters(vldSimCounters *counters)
+{
+  counters->reads = __atomic_load_n(&simCount.reads, __ATOMIC_RELAXED);
+  counters->writes = __atomic_load_n(&simCount.writes, __ATOMIC_RELAXED);
+  counters->probes = __atomic_load_n(&simCount.probes, __ATOMIC_RELAXED);
+  counters->busErrors = __atomic_load_n(&simCount.busErrors, __ATOMIC_RELAXED);
+  counters->blockReads = __atomic_load_n(&simCount.blockReads, __ATOMIC_RELAXED);
+  counters->chainedReads = __atomic_load_n(&simCount.chainedReads, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Reset the simulated bus access counters
+ */
+void
+vldSimResetCounters()
+{
+  __atomic_store_n(&simCount.reads, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&simCount.writes, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&simCount.probes, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&simCount.busErrors, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&simCount.blockReads, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&simCount.chainedReads, 0, __ATOMIC_RELAXED);
+}